@@ -55,15 +55,19 @@ unsigned int g_last_update_tick[USER_DIES][USER_BLOCKS_PER_DIE];
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "sim_backend.h" /* jy */
 
 /* ===== FTL Summary counters (final report only) ===== */
 static uint64_t ts_total_writes = 0;
 static uint64_t ts_total_invalidates = 0;
 static uint64_t ts_total_erases = 0;
+static uint64_t ts_stream_writes[WRITE_STREAMS];
 
 /* from GC */
 extern void TsGcGetSummary(uint64_t *gc_selects, uint64_t *gc_valid_sum);
+extern void TsGcResetSummary(void);
+extern void TsGcGetBgSummary(uint64_t *gc_bg_runs, uint64_t *gc_steps);
 
 static void TsDumpSummary(void)
 {
@@ -76,10 +80,36 @@ static void TsDumpSummary(void)
     printf("Erases (blocks)     : %llu\n", (unsigned long long)ts_total_erases);
     printf("GC victim selects   : %llu\n", (unsigned long long)gc_selects);
     printf("GC valid copied sum : %llu\n", (unsigned long long)gc_valid_sum);
+    if (writeStreamsEnabled)
+        printf("Stream writes       : hot %llu, cold %llu, gc %llu\n", (unsigned long long)ts_stream_writes[WRITE_STREAM_HOT],
+                (unsigned long long)ts_stream_writes[WRITE_STREAM_COLD], (unsigned long long)ts_stream_writes[WRITE_STREAM_GC]);
+    if (gcVictimPolicy != GC_VICTIM_GREEDY)
+        printf("GC victim policy    : %s\n", gcVictimPolicyNames[gcVictimPolicy]);
+    if (gcBgFreeBlocks) {
+        uint64_t gc_bg_runs = 0, gc_steps = 0;
+        TsGcGetBgSummary(&gc_bg_runs, &gc_steps);
+        printf("GC background runs  : %llu (below %u free blocks per die)\n", (unsigned long long)gc_bg_runs, gcBgFreeBlocks);
+        printf("GC steps            : %llu (at most %u copies each in background)\n", (unsigned long long)gc_steps, gcCopiesPerStep);
+    }
+    if (tempDataBufPerDie > 1)
+        printf("GC temp buffers     : %u per die, %llu of %llu copies waited for one\n", tempDataBufPerDie,
+                tempDataBufBusyCnt, tempDataBufAllocCnt);
     printf("==== End of Summary ====\n");
     fflush(0);
 }
 
+/* drop what the sim did before the timed run (aging) */
+void TsResetSummary(void)
+{
+    ts_total_writes = 0;
+    ts_total_invalidates = 0;
+    ts_total_erases = 0;
+    memset(ts_stream_writes, 0, sizeof(ts_stream_writes));
+    tempDataBufAllocCnt = 0;
+    tempDataBufBusyCnt = 0;
+    TsGcResetSummary();
+}
+
 
 P_LOGICAL_SLICE_MAP logicalSliceMapPtr;
 P_VIRTUAL_SLICE_MAP virtualSliceMapPtr;
@@ -90,6 +120,17 @@ P_BAD_BLOCK_TABLE_INFO_MAP bbtInfoMapPtr;
 
 unsigned char sliceAllocationTargetDie;
 unsigned int mbPerbadBlockSpace;
+#if 1 //jy
+/* set while the sim ages the maps: GC and erase update the tables only, no NAND request is issued */
+unsigned int mappingOnly = 0;
+
+/* host writes go to a hot or a cold open block by how often the slice was written lately, GC copies to a third */
+unsigned int writeStreamsEnabled = 0;
+/* open block of each stream, the hot stream's is virtualDieMapPtr->die[].currentBlock; BLOCK_NONE until first used */
+unsigned int streamBlock[USER_DIES][WRITE_STREAMS];
+unsigned char sliceWriteCnt[SLICES_PER_SSD];
+static unsigned int sliceWritesSinceDecay = 0;
+#endif
 
 
 void InitAddressMap()
@@ -294,6 +335,11 @@ void InitCurrentBlockOfDieMap()
 		virtualDieMapPtr->die[dieNo].currentBlock = GetFromFbList(dieNo, GET_FREE_BLOCK_NORMAL);
 		if(virtualDieMapPtr->die[dieNo].currentBlock == BLOCK_FAIL)
 			assert(!"[WARNING] There is no free block [WARNING]");
+#if 1 //jy
+		streamBlock[dieNo][WRITE_STREAM_HOT] = BLOCK_NONE;
+		streamBlock[dieNo][WRITE_STREAM_COLD] = BLOCK_NONE;
+		streamBlock[dieNo][WRITE_STREAM_GC] = BLOCK_NONE;
+#endif
 	}
 }
 
@@ -686,6 +732,138 @@ unsigned int AddrTransRead(unsigned int logicalSliceAddr)
 		assert(!"[WARNING] Logical address is larger than maximum logical address served by SSD [WARNING]");
 }
 
+#if 1 //jy
+// counts the host write of the slice; every SLICE_WRITE_CNT_DECAY writes all counts are halved so old heat fades
+static unsigned int ClassifySliceTemperature(unsigned int logicalSliceAddr)
+{
+	unsigned int sliceNo;
+
+	if(++sliceWritesSinceDecay >= SLICE_WRITE_CNT_DECAY)
+	{
+		for(sliceNo = 0; sliceNo < SLICES_PER_SSD; sliceNo++)
+			sliceWriteCnt[sliceNo] >>= 1;
+		sliceWritesSinceDecay = 0;
+	}
+	if(sliceWriteCnt[logicalSliceAddr] != 0xff)
+		sliceWriteCnt[logicalSliceAddr]++;
+
+	return (sliceWriteCnt[logicalSliceAddr] >= HOT_SLICE_WRITE_CNT) ? WRITE_STREAM_HOT : WRITE_STREAM_COLD;
+}
+
+static unsigned int GetStreamBlock(unsigned int dieNo, unsigned int stream)
+{
+	if(stream == WRITE_STREAM_HOT)
+		return virtualDieMapPtr->die[dieNo].currentBlock;
+	return streamBlock[dieNo][stream];
+}
+
+static void SetStreamBlock(unsigned int dieNo, unsigned int stream, unsigned int blockNo)
+{
+	if(stream == WRITE_STREAM_HOT)
+		virtualDieMapPtr->die[dieNo].currentBlock = blockNo;
+	else
+		streamBlock[dieNo][stream] = blockNo;
+}
+
+static unsigned int StreamBlockFull(unsigned int dieNo, unsigned int blockNo)
+{
+	if(blockNo == BLOCK_NONE)
+		return 1;
+	if(virtualBlockMapPtr->block[dieNo][blockNo].currentPage > USER_PAGES_PER_BLOCK)
+		assert(!"[WARNING] Current page management fail [WARNING]");
+	return virtualBlockMapPtr->block[dieNo][blockNo].currentPage == USER_PAGES_PER_BLOCK;
+}
+
+/*
+ * GC took an open block as its victim, the stream opens a new one on its
+ * next write. Without streams the host block is replaced right away by
+ * GarbageCollectionStep(), as GC copies share it.
+ */
+void CloseStreamBlock(unsigned int dieNo, unsigned int blockNo)
+{
+	if(!writeStreamsEnabled)
+		return;
+	if(virtualDieMapPtr->die[dieNo].currentBlock == blockNo)
+		virtualDieMapPtr->die[dieNo].currentBlock = BLOCK_NONE;
+	if(streamBlock[dieNo][WRITE_STREAM_COLD] == blockNo)
+		streamBlock[dieNo][WRITE_STREAM_COLD] = BLOCK_NONE;
+	if(streamBlock[dieNo][WRITE_STREAM_GC] == blockNo)
+		streamBlock[dieNo][WRITE_STREAM_GC] = BLOCK_NONE;
+}
+
+/*
+ * Background GC stops between steps with copies left to do, and host writes
+ * in the meantime take pages those copies need: the shared open block
+ * without streams, whole blocks with them. Before such a write would leave
+ * the die fewer free pages than the victim still holds valid slices, the
+ * host finishes the victim, as foreground GC would have done.
+ */
+static unsigned int GcPagesNeeded(unsigned int dieNo)
+{
+	unsigned int victimBlockNo = gcDieState[dieNo].victimBlock;
+	unsigned int doneSliceCnt;
+
+	if(victimBlockNo == BLOCK_NONE)
+		return 0;
+	doneSliceCnt = virtualBlockMapPtr->block[dieNo][victimBlockNo].invalidSliceCnt + gcDieState[dieNo].copiedSliceCnt;
+	return (doneSliceCnt < SLICES_PER_BLOCK) ? SLICES_PER_BLOCK - doneSliceCnt : 0;
+}
+
+// pages GC copies can still be written to: the rest of the block they go to and all free blocks
+static unsigned int GcPagesFree(unsigned int dieNo)
+{
+	unsigned int blockNo, pages;
+
+	blockNo = writeStreamsEnabled ? streamBlock[dieNo][WRITE_STREAM_GC] : virtualDieMapPtr->die[dieNo].currentBlock;
+	pages = virtualDieMapPtr->die[dieNo].freeBlockCnt * USER_PAGES_PER_BLOCK;
+	if(blockNo != BLOCK_NONE)
+		pages += USER_PAGES_PER_BLOCK - virtualBlockMapPtr->block[dieNo][blockNo].currentPage;
+	return pages;
+}
+
+// hostPages: what the coming host write takes from GcPagesFree()
+static void KeepPagesForGc(unsigned int dieNo, unsigned int hostPages)
+{
+	if(GcPagesFree(dieNo) < GcPagesNeeded(dieNo) + hostPages)
+		GarbageCollection(dieNo);
+}
+
+// FindFreeVirtualSlice() for a host stream, each stream fills its own open block on the allocation target die
+unsigned int FindFreeVirtualSliceOfStream(unsigned int stream)
+{
+	unsigned int currentBlock, virtualSliceAddr, dieNo;
+
+	dieNo = sliceAllocationTargetDie;
+	// a host stream only takes from the GC's pages when it opens a block
+	if(StreamBlockFull(dieNo, GetStreamBlock(dieNo, stream)))
+		KeepPagesForGc(dieNo, USER_PAGES_PER_BLOCK);
+	currentBlock = GetStreamBlock(dieNo, stream);
+
+	if(StreamBlockFull(dieNo, currentBlock))
+	{
+		// the GC stream can take the block a GC run freed, so run GC until one is left for the host
+		currentBlock = GetFromFbList(dieNo, GET_FREE_BLOCK_NORMAL);
+		while(currentBlock == BLOCK_FAIL)
+		{
+			GarbageCollection(dieNo);
+			currentBlock = GetStreamBlock(dieNo, stream);
+			if(!StreamBlockFull(dieNo, currentBlock))
+				break;
+			currentBlock = GetFromFbList(dieNo, GET_FREE_BLOCK_NORMAL);
+		}
+		SetStreamBlock(dieNo, stream, currentBlock);
+	}
+
+	virtualSliceAddr = Vorg2VsaTranslation(dieNo, currentBlock, virtualBlockMapPtr->block[dieNo][currentBlock].currentPage);
+	virtualBlockMapPtr->block[dieNo][currentBlock].currentPage++;
+	g_last_update_tick[dieNo][currentBlock] = ++g_cb_tick;
+	UpdateGcVictimIndex(dieNo, currentBlock);
+	ts_stream_writes[stream]++;
+	sliceAllocationTargetDie = FindDieForFreeSliceAllocation();
+	return virtualSliceAddr;
+}
+#endif
+
 unsigned int AddrTransWrite(unsigned int logicalSliceAddr)
 {
 	unsigned int virtualSliceAddr;
@@ -694,6 +872,11 @@ unsigned int AddrTransWrite(unsigned int logicalSliceAddr)
 	{
 		InvalidateOldVsa(logicalSliceAddr);
 
+#if 1 //jy
+		if(writeStreamsEnabled)
+			virtualSliceAddr = FindFreeVirtualSliceOfStream(ClassifySliceTemperature(logicalSliceAddr));
+		else
+#endif
 		virtualSliceAddr = FindFreeVirtualSlice();
 
 		logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr = virtualSliceAddr;
@@ -712,6 +895,10 @@ unsigned int FindFreeVirtualSlice()
 	unsigned int currentBlock, virtualSliceAddr, dieNo;
 
 	dieNo = sliceAllocationTargetDie;
+#if 1 //jy
+	// host writes and GC copies share currentBlock, every write takes one page
+	KeepPagesForGc(dieNo, 1);
+#endif
 	currentBlock = virtualDieMapPtr->die[dieNo].currentBlock;
 
 	if(virtualBlockMapPtr->block[dieNo][currentBlock].currentPage == USER_PAGES_PER_BLOCK)
@@ -744,6 +931,7 @@ unsigned int FindFreeVirtualSlice()
 	virtualSliceAddr = Vorg2VsaTranslation(dieNo, currentBlock, virtualBlockMapPtr->block[dieNo][currentBlock].currentPage);
 	virtualBlockMapPtr->block[dieNo][currentBlock].currentPage++;
 	g_last_update_tick[dieNo][currentBlock] = ++g_cb_tick;
+	UpdateGcVictimIndex(dieNo, currentBlock);
 	sliceAllocationTargetDie = FindDieForFreeSliceAllocation();
 	dieNo = sliceAllocationTargetDie;
 	return virtualSliceAddr;
@@ -755,6 +943,26 @@ unsigned int FindFreeVirtualSliceForGc(unsigned int copyTargetDieNo, unsigned in
 	unsigned int currentBlock, virtualSliceAddr, dieNo;
 
 	dieNo = copyTargetDieNo;
+#if 1 //jy
+	if(writeStreamsEnabled)
+	{
+		currentBlock = streamBlock[dieNo][WRITE_STREAM_GC];
+		if(StreamBlockFull(dieNo, currentBlock))
+		{
+			currentBlock = GetFromFbList(dieNo, GET_FREE_BLOCK_GC);
+			if(currentBlock == BLOCK_FAIL)
+				assert(!"[WARNING] There is no available block [WARNING]");
+			streamBlock[dieNo][WRITE_STREAM_GC] = currentBlock;
+		}
+
+		virtualSliceAddr = Vorg2VsaTranslation(dieNo, currentBlock, virtualBlockMapPtr->block[dieNo][currentBlock].currentPage);
+		virtualBlockMapPtr->block[dieNo][currentBlock].currentPage++;
+		g_last_update_tick[dieNo][currentBlock] = ++g_cb_tick;
+		UpdateGcVictimIndex(dieNo, currentBlock);
+		ts_stream_writes[WRITE_STREAM_GC]++;
+		return virtualSliceAddr;
+	}
+#endif
 	if(victimBlockNo == virtualDieMapPtr->die[dieNo].currentBlock)
 	{
 		virtualDieMapPtr->die[dieNo].currentBlock = GetFromFbList(dieNo, GET_FREE_BLOCK_GC);
@@ -780,6 +988,7 @@ unsigned int FindFreeVirtualSliceForGc(unsigned int copyTargetDieNo, unsigned in
 	virtualSliceAddr = Vorg2VsaTranslation(dieNo, currentBlock, virtualBlockMapPtr->block[dieNo][currentBlock].currentPage);
 	virtualBlockMapPtr->block[dieNo][currentBlock].currentPage++;
 	g_last_update_tick[dieNo][currentBlock] = ++g_cb_tick;
+	UpdateGcVictimIndex(dieNo, currentBlock);
 	return virtualSliceAddr;
 }
 
@@ -817,6 +1026,17 @@ void InvalidateOldVsa(unsigned int logicalSliceAddr)
 		dieNo = Vsa2VdieTranslation(virtualSliceAddr);
 		blockNo = Vsa2VblockTranslation(virtualSliceAddr);
 
+#if 1 //jy
+		// the victim of an unfinished GC is in no victim list
+		if(blockNo == gcDieState[dieNo].victimBlock)
+		{
+			virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt++;
+			g_last_update_tick[dieNo][blockNo] = ++g_cb_tick;
+			logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr = VSA_NONE;
+			ts_total_invalidates++;
+			return;
+		}
+#endif
 		// unlink
 		SelectiveGetFromGcVictimList(dieNo, blockNo);
 		virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt++;
@@ -834,6 +1054,10 @@ void EraseBlock(unsigned int dieNo, unsigned int blockNo)
 {
 	unsigned int pageNo, virtualSliceAddr, reqSlotTag;
 
+#if 1 //jy
+	if(!mappingOnly)
+	{
+#endif
 	reqSlotTag = GetFromFreeReqQ();
 
 	reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
@@ -846,6 +1070,9 @@ void EraseBlock(unsigned int dieNo, unsigned int blockNo)
 	reqPoolPtr->reqPool[reqSlotTag].nandInfo.programmedPageCnt = virtualBlockMapPtr->block[dieNo][blockNo].currentPage;
 
 	SelectLowLevelReqQ(reqSlotTag);
+#if 1 //jy
+	}
+#endif
 
 	// block map indicated blockNo initialization
 	virtualBlockMapPtr->block[dieNo][blockNo].free = 1;
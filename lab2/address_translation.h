@@ -69,6 +69,16 @@
 #define GET_FREE_BLOCK_NORMAL	0x0
 #define GET_FREE_BLOCK_GC		0x1
 
+#if 1 //jy
+#define WRITE_STREAM_HOT		0	// host writes of slices rewritten lately, to the die's currentBlock
+#define WRITE_STREAM_COLD		1	// other host writes
+#define WRITE_STREAM_GC			2	// GC copies
+#define WRITE_STREAMS			3
+
+#define HOT_SLICE_WRITE_CNT		2						// host writes since the last decay that make a slice hot
+#define SLICE_WRITE_CNT_DECAY	(SLICES_PER_SSD / 16)	// host writes between halving every slice's count
+#endif
+
 #define BLOCK_STATE_NORMAL						0
 #define BLOCK_STATE_BAD							1
 
@@ -193,6 +203,10 @@ unsigned int AddrTransWrite(unsigned int logicalSliceAddr);
 unsigned int FindFreeVirtualSlice();
 unsigned int FindFreeVirtualSliceForGc(unsigned int copyTargetDieNo, unsigned int victimBlockNo);
 unsigned int FindDieForFreeSliceAllocation();
+#if 1 //jy
+unsigned int FindFreeVirtualSliceOfStream(unsigned int stream);
+void CloseStreamBlock(unsigned int dieNo, unsigned int blockNo);
+#endif
 
 void InvalidateOldVsa(unsigned int logicalSliceAddr);
 void EraseBlock(unsigned int dieNo, unsigned int blockNo);
@@ -213,5 +227,11 @@ extern P_BAD_BLOCK_TABLE_INFO_MAP bbtInfoMapPtr;
 
 extern unsigned char sliceAllocationTargetDie;
 extern unsigned int mbPerbadBlockSpace;
+extern unsigned int mappingOnly; /* jy */
+#if 1 //jy
+extern unsigned int writeStreamsEnabled;
+extern unsigned int streamBlock[USER_DIES][WRITE_STREAMS];
+extern unsigned char sliceWriteCnt[SLICES_PER_SSD];
+#endif
 
 #endif /* ADDRESS_TRANSLATION_H_ */
@@ -0,0 +1,168 @@
+/*
+ * Microbenchmark for the backend event queue (sim/sim_backend.c).
+ *
+ * Keeps "depth" NAND events outstanding and repeatedly warps the timer,
+ * refilling the queue with the latencies SchedulingNand() uses. The same
+ * event stream is driven through the old sorted TAILQ (kept here as a
+ * reference) and through g_timer, and the completion order is compared.
+ *
+ *   make bench && ./bench/timer_bench [events]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/queue.h>
+
+#include "sim_backend.h"
+#include "ftl_config.h"
+
+static const unsigned long long lat_table[] = {30, 300, 650, 15000, 5};
+
+struct list_entry {
+	unsigned long long trigger_time;
+	unsigned int ch;
+	unsigned int way;
+	unsigned int id;
+	TAILQ_ENTRY(list_entry) entry;
+};
+
+static TAILQ_HEAD(list_head, list_entry) list_q;
+static unsigned long long list_time;
+static unsigned int list_last_done;
+
+static void list_put(struct list_entry *task) {
+	struct list_entry *entry;
+
+	set_busy(task->ch, task->way);
+	TAILQ_FOREACH(entry, &list_q, entry) {
+		if (entry->trigger_time > task->trigger_time) {
+			TAILQ_INSERT_BEFORE(entry, task, entry);
+			return;
+		}
+	}
+	TAILQ_INSERT_TAIL(&list_q, task, entry);
+}
+
+static unsigned int list_warp() {
+	struct list_entry *task = TAILQ_FIRST(&list_q);
+	struct list_entry *next_task;
+	unsigned int n = 0;
+
+	list_time = task->trigger_time;
+	do {
+		next_task = TAILQ_NEXT(task, entry);
+		clear_busy(task->ch, task->way);
+		list_last_done = task->id;
+		TAILQ_REMOVE(&list_q, task, entry);
+		free(task);
+		task = next_task;
+		n++;
+	} while (task && task->trigger_time == list_time);
+
+	return n;
+}
+
+static unsigned int lcg_next(unsigned int *state) {
+	*state = *state * 1103515245 + 12345;
+	return *state >> 16;
+}
+
+static double now_sec() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* order signature: fold (time, group size, last completed id) of every warp */
+static unsigned long long sig_fold(unsigned long long sig, unsigned long long t, unsigned int n, unsigned int last) {
+	sig ^= t + 0x9e3779b97f4a7c15ULL + (sig << 6) + (sig >> 2);
+	sig ^= n + 0x9e3779b97f4a7c15ULL + (sig << 6) + (sig >> 2);
+	sig ^= last + 0x9e3779b97f4a7c15ULL + (sig << 6) + (sig >> 2);
+	return sig;
+}
+
+static double run_list(unsigned int depth, unsigned int nevents, unsigned long long *sig) {
+	struct list_entry *task;
+	unsigned int seed = 1, id = 0, done = 0, n;
+	double start;
+
+	TAILQ_INIT(&list_q);
+	list_time = 0;
+	*sig = 0;
+
+	start = now_sec();
+	while (done < nevents) {
+		while (id - done < depth) {
+			task = (struct list_entry *)malloc(sizeof(struct list_entry));
+			task->trigger_time = list_time + lat_table[lcg_next(&seed) % 5];
+			task->ch = id % USER_CHANNELS;
+			task->way = (id / USER_CHANNELS) % USER_WAYS;
+			task->id = ++id;
+			list_put(task);
+		}
+		n = list_warp();
+		done += n;
+		*sig = sig_fold(*sig, list_time, n, list_last_done);
+	}
+
+	while (!TAILQ_EMPTY(&list_q))
+		list_warp();
+
+	return now_sec() - start;
+}
+
+static double run_heap(unsigned int depth, unsigned int nevents, unsigned long long *sig) {
+	struct timer_pqueue_entry *task;
+	unsigned int seed = 1, id = 0, done = 0, n, last_done = 0;
+	double start;
+
+	init_g_timer();
+	*sig = 0;
+
+	start = now_sec();
+	while (done < nevents) {
+		while (id - done < depth) {
+			id++;
+			task = task_create_raw((id - 1) % USER_CHANNELS, ((id - 1) / USER_CHANNELS) % USER_WAYS,
+					lat_table[lcg_next(&seed) % 5], &last_done, id);
+			timer_put(task);
+		}
+		n = g_timer.ongoing;
+		timer_warp();
+		n -= g_timer.ongoing;
+		done += n;
+		*sig = sig_fold(*sig, g_timer.current_time, n, last_done);
+	}
+
+	while (!TIMER_EMPTY())
+		timer_warp();
+
+	return now_sec() - start;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned int depths[] = {USER_CHANNELS * USER_WAYS, 64, 512, 4096};
+	unsigned int nevents = 2000000;
+	unsigned long long list_sig, heap_sig;
+	double list_sec, heap_sec;
+	int i, ret = 0;
+
+	if (argc > 1)
+		nevents = atoi(argv[1]);
+
+	init_nand();
+	InitChCtlReg();
+
+	printf("%8s %16s %16s %8s %6s\n", "depth", "list(ev/s)", "heap(ev/s)", "speedup", "order");
+	for (i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+		list_sec = run_list(depths[i], nevents, &list_sig);
+		heap_sec = run_heap(depths[i], nevents, &heap_sig);
+		printf("%8u %16.0f %16.0f %7.2fx %6s\n", depths[i], nevents / list_sec, nevents / heap_sec,
+				list_sec / heap_sec, list_sig == heap_sig ? "same" : "DIFF");
+		if (list_sig != heap_sig)
+			ret = 1;
+	}
+
+	return ret;
+}
@@ -46,6 +46,7 @@
 
 #include "printf.h"
 #include <assert.h>
+#include <string.h>
 #include "memory_map.h"
 #include "sim_backend.h" /* jy */
 
@@ -54,6 +55,12 @@ P_DATA_BUF_MAP dataBufMapPtr;
 DATA_BUF_LRU_LIST dataBufLruList;
 P_DATA_BUF_HASH_TABLE dataBufHashTablePtr;
 P_TEMPORARY_DATA_BUF_MAP tempDataBufMapPtr;
+#if 1 //jy
+/* temp entries a die's GC copies rotate through, at most TEMPORARY_DATA_BUFFER_ENTRIES_PER_DIE */
+unsigned int tempDataBufPerDie = 1;
+unsigned long long tempDataBufAllocCnt, tempDataBufBusyCnt;
+static unsigned int tempDataBufNext[USER_DIES];
+#endif
 
 void InitDataBuf()
 {
@@ -84,6 +91,9 @@ void InitDataBuf()
 
 	for(bufEntry = 0; bufEntry < AVAILABLE_TEMPORARY_DATA_BUFFER_ENTRY_COUNT; bufEntry++)
 		tempDataBufMapPtr->tempDataBuf[bufEntry].blockingReqTail =  REQ_SLOT_TAG_NONE;
+#if 1 //jy
+	memset(tempDataBufNext, 0, sizeof(tempDataBufNext));
+#endif
 }
 
 unsigned int CheckDataBufHit(unsigned int reqSlotTag)
@@ -186,10 +196,40 @@ void UpdateDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int reqSl
 }
 
 
+#if 1 //jy
+/*
+ * An entry of the die's share of the pool that no request holds any more,
+ * looked for from the one after the last handed out. When all are held the
+ * next one in turn is reused and its new requests wait behind the old ones.
+ */
+unsigned int AllocateTempDataBuf(unsigned int dieNo)
+{
+	unsigned int i, idx, bufEntry;
+
+	tempDataBufAllocCnt++;
+	for(i = 0; i < tempDataBufPerDie; i++)
+	{
+		idx = (tempDataBufNext[dieNo] + i) % tempDataBufPerDie;
+		bufEntry = dieNo * TEMPORARY_DATA_BUFFER_ENTRIES_PER_DIE + idx;
+		if(tempDataBufMapPtr->tempDataBuf[bufEntry].blockingReqTail == REQ_SLOT_TAG_NONE)
+			break;
+	}
+	if(i == tempDataBufPerDie)
+	{
+		tempDataBufBusyCnt++;
+		idx = tempDataBufNext[dieNo] % tempDataBufPerDie;
+		bufEntry = dieNo * TEMPORARY_DATA_BUFFER_ENTRIES_PER_DIE + idx;
+	}
+	tempDataBufNext[dieNo] = (idx + 1) % tempDataBufPerDie;
+
+	return bufEntry;
+}
+#else
 unsigned int AllocateTempDataBuf(unsigned int dieNo)
 {
 	return dieNo;
 }
+#endif
 
 
 void UpdateTempDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int reqSlotTag)
@@ -50,7 +50,12 @@
 #include "ftl_config.h"
 
 #define AVAILABLE_DATA_BUFFER_ENTRY_COUNT				(16 * USER_DIES)
+#if 1 //jy
+#define TEMPORARY_DATA_BUFFER_ENTRIES_PER_DIE			16
+#define AVAILABLE_TEMPORARY_DATA_BUFFER_ENTRY_COUNT		(USER_DIES * TEMPORARY_DATA_BUFFER_ENTRIES_PER_DIE)
+#else
 #define AVAILABLE_TEMPORARY_DATA_BUFFER_ENTRY_COUNT		(USER_DIES)
+#endif
 
 #define DATA_BUF_NONE	0xffff
 #define DATA_BUF_FAIL	0xffff
@@ -115,5 +120,9 @@ extern P_DATA_BUF_MAP dataBufMapPtr;
 extern DATA_BUF_LRU_LIST dataBufLruList;
 extern P_DATA_BUF_HASH_TABLE dataBufHashTable;
 extern P_TEMPORARY_DATA_BUF_MAP tempDataBufMapPtr;
+#if 1 //jy
+extern unsigned int tempDataBufPerDie;
+extern unsigned long long tempDataBufAllocCnt, tempDataBufBusyCnt;
+#endif
 
 #endif /* DATA_BUFFER_H_ */
@@ -127,10 +127,11 @@
 
 #if 1 //jy
 #define	ROWS_PER_SLC_BLOCK			256
+#define	ROWS_PER_MLC_BLOCK			512		// SLC pages sit on LSB rows up to Vpage2PlsbPageTranslation(255) = 509
 #else
 #define	ROWS_PER_SLC_BLOCK			128
-#endif
 #define	ROWS_PER_MLC_BLOCK			256
+#endif
 
 #define	MAIN_BLOCKS_PER_LUN			4096
 #define EXTENDED_BLOCKS_PER_LUN		88
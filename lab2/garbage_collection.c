@@ -50,11 +50,58 @@
 */
 #include <stdio.h>  /* jy */
 #include "sim_backend.h" /* jy */
+#include "sim_stall.h" /* jy */
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include "memory_map.h"
 
 P_GC_VICTIM_MAP gcVictimMapPtr;
 
+/* ===== GC summary counters (console, gc_stats.csv, final report) ===== */
+uint64_t g_ts_gc_victim_selects = 0;
+uint64_t g_ts_gc_valid_copied_sum = 0;
+uint64_t g_ts_gc_bg_runs = 0;
+uint64_t g_ts_gc_steps = 0;
+
+void TsGcGetSummary(uint64_t *gc_selects, uint64_t *gc_valid_sum)
+{
+	*gc_selects = g_ts_gc_victim_selects;
+	*gc_valid_sum = g_ts_gc_valid_copied_sum;
+}
+
+void TsGcGetBgSummary(uint64_t *gc_bg_runs, uint64_t *gc_steps)
+{
+	*gc_bg_runs = g_ts_gc_bg_runs;
+	*gc_steps = g_ts_gc_steps;
+}
+
+void TsGcResetSummary(void)
+{
+	g_ts_gc_victim_selects = 0;
+	g_ts_gc_valid_copied_sum = 0;
+	g_ts_gc_bg_runs = 0;
+	g_ts_gc_steps = 0;
+}
+
+#if 1 //jy
+/* free blocks per die below which idle dies collect in the background, 0 for foreground GC only */
+unsigned int gcBgFreeBlocks = 0;
+/* valid slices a background GC step copies at most */
+unsigned int gcCopiesPerStep = USER_PAGES_PER_BLOCK;
+GC_DIE_STATE gcDieState[USER_DIES];
+
+unsigned int gcVictimPolicy = GC_VICTIM_GREEDY;
+unsigned int gcVictimWindow = 8;
+const char *gcVictimPolicyNames[GC_VICTIM_POLICIES] = {"greedy", "cb", "cat", "rgreedy"};
+
+extern unsigned int g_cb_tick;
+extern unsigned int g_last_update_tick[USER_DIES][USER_BLOCKS_PER_DIE];
+
+/* rgreedy samples, seeded from --seed by the sim and saved in snapshots */
+struct rng gcRng;
+#endif
+
 void InitGcVictimMap()
 {
 	int dieNo, invalidSliceCnt;
@@ -68,10 +115,154 @@ void InitGcVictimMap()
 			gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock = BLOCK_NONE;
 			gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].tailBlock = BLOCK_NONE;
 		}
+#if 1 //jy
+		gcDieState[dieNo].victimBlock = BLOCK_NONE;
+#endif
 	}
 }
 
 
+#if 1 //jy
+static void GcCopySlice(unsigned int dieNo, unsigned int victimBlockNo, unsigned int virtualSliceAddr, unsigned int logicalSliceAddr)
+{
+	unsigned int dieNoForGcCopy, reqSlotTag, tempBufEntry;
+
+	/*
+	 * Copies stay on the victim's die. A copy programmed on another die has
+	 * to wait for its read here, and the later programs to that die's open
+	 * block wait behind it in page order. Host writes already keep every
+	 * die busy, so there is no idle die to win time on.
+	 */
+	dieNoForGcCopy = dieNo;
+	g_ts_gc_valid_copied_sum++;
+
+	if(mappingOnly)
+	{
+		virtualSliceAddr = FindFreeVirtualSliceForGc(dieNoForGcCopy, victimBlockNo);
+		logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr = virtualSliceAddr;
+		virtualSliceMapPtr->virtualSlice[virtualSliceAddr].logicalSliceAddr = logicalSliceAddr;
+		return;
+	}
+
+	//read
+	reqSlotTag = GetFromFreeReqQ();
+
+	reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
+	reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_READ;
+	reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = logicalSliceAddr;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_TEMP_ENTRY;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_OFF;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
+	// the write takes the data from the entry the read fills, so both use the one allocated here
+	tempBufEntry = AllocateTempDataBuf(dieNo);
+	reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = tempBufEntry;
+	UpdateTempDataBufEntryInfoBlockingReq(reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry, reqSlotTag);
+	reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
+
+	SelectLowLevelReqQ(reqSlotTag);
+
+	//write
+	reqSlotTag = GetFromFreeReqQ();
+
+	reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
+	reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_WRITE;
+	reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = logicalSliceAddr;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_TEMP_ENTRY;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_OFF;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
+	reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = tempBufEntry;
+	UpdateTempDataBufEntryInfoBlockingReq(reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry, reqSlotTag);
+	reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = FindFreeVirtualSliceForGc(dieNoForGcCopy, victimBlockNo);
+
+	logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr = reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr;
+	virtualSliceMapPtr->virtualSlice[reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr].logicalSliceAddr = logicalSliceAddr;
+
+	SelectLowLevelReqQ(reqSlotTag);
+}
+
+/*
+ * One step of the die's GC: a victim is taken when none is in progress, then
+ * at most maxCopies valid slices are copied from where the last step stopped.
+ * The victim is erased once its last page was looked at. Returns 1 then.
+ * Host writes that invalidate the victim meanwhile only shorten the work left.
+ */
+unsigned int GarbageCollectionStep(unsigned int dieNo, unsigned int maxCopies)
+{
+	P_GC_DIE_STATE gcState = &gcDieState[dieNo];
+	unsigned int victimBlockNo, pageNo, virtualSliceAddr, logicalSliceAddr, copies;
+
+	if(gcState->victimBlock == BLOCK_NONE)
+	{
+		victimBlockNo = GetFromGcVictimList(dieNo);
+		g_ts_gc_victim_selects++;
+		gcState->victimBlock = victimBlockNo;
+		gcState->nextPage = 0;
+		gcState->copiedSliceCnt = 0;
+		CloseStreamBlock(dieNo, victimBlockNo);
+
+		// host writes between the steps must not go to the victim
+		if((victimBlockNo == virtualDieMapPtr->die[dieNo].currentBlock) && (virtualBlockMapPtr->block[dieNo][victimBlockNo].invalidSliceCnt != SLICES_PER_BLOCK))
+		{
+			virtualDieMapPtr->die[dieNo].currentBlock = GetFromFbList(dieNo, GET_FREE_BLOCK_GC);
+			if(virtualDieMapPtr->die[dieNo].currentBlock == BLOCK_FAIL)
+				assert(!"[WARNING] There is no available block [WARNING]");
+		}
+	}
+	victimBlockNo = gcState->victimBlock;
+	g_ts_gc_steps++;
+	stall_gc_begin();
+
+	copies = 0;
+	while((gcState->nextPage < USER_PAGES_PER_BLOCK) && (copies < maxCopies) &&
+			(virtualBlockMapPtr->block[dieNo][victimBlockNo].invalidSliceCnt != SLICES_PER_BLOCK))
+	{
+		pageNo = gcState->nextPage++;
+		virtualSliceAddr = Vorg2VsaTranslation(dieNo, victimBlockNo, pageNo);
+		logicalSliceAddr = virtualSliceMapPtr->virtualSlice[virtualSliceAddr].logicalSliceAddr;
+
+		if(logicalSliceAddr != LSA_NONE)
+			if(logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr ==  virtualSliceAddr) //valid data
+			{
+				GcCopySlice(dieNo, victimBlockNo, virtualSliceAddr, logicalSliceAddr);
+				gcState->copiedSliceCnt++;
+				copies++;
+			}
+	}
+
+	if((gcState->nextPage < USER_PAGES_PER_BLOCK) && (virtualBlockMapPtr->block[dieNo][victimBlockNo].invalidSliceCnt != SLICES_PER_BLOCK))
+	{
+		stall_gc_end();
+		return 0;
+	}
+
+	gcState->victimBlock = BLOCK_NONE;
+	EraseBlock(dieNo, victimBlockNo);
+	stall_gc_end();
+	return 1;
+}
+
+// foreground GC: runs the die's GC in progress, or a new one, to the erase
+void GarbageCollection(unsigned int dieNo)
+{
+	GarbageCollectionStep(dieNo, USER_PAGES_PER_BLOCK);
+}
+
+// every die's GC in progress runs to the erase, so no victim is left outside the lists
+void FinishGarbageCollection()
+{
+	unsigned int dieNo;
+
+	for(dieNo = 0; dieNo < USER_DIES; dieNo++)
+		if(gcDieState[dieNo].victimBlock != BLOCK_NONE)
+			GarbageCollectionStep(dieNo, USER_PAGES_PER_BLOCK);
+}
+#else
 void GarbageCollection(unsigned int dieNo)
 {
 	unsigned int victimBlockNo, pageNo, virtualSliceAddr, logicalSliceAddr, dieNoForGcCopy, reqSlotTag;
@@ -134,9 +325,237 @@ void GarbageCollection(unsigned int dieNo)
 	EraseBlock(dieNo, victimBlockNo);
 }
 
+#endif
+
+#if 1 //jy
+// invalid slice count of the block GetFromGcVictimList() would return, 0 when there is nothing to gain
+static unsigned int PeekGcVictimInvalidCnt(unsigned int dieNo)
+{
+	int invalidSliceCnt;
+
+	for(invalidSliceCnt = SLICES_PER_BLOCK; invalidSliceCnt > 0 ; invalidSliceCnt--)
+		if(gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock != BLOCK_NONE)
+			return invalidSliceCnt;
+	return 0;
+}
+
+static unsigned int BackgroundGcWanted(unsigned int dieNo)
+{
+	// at the reserve the host runs foreground GC on its next block anyway
+	return (virtualDieMapPtr->die[dieNo].freeBlockCnt < gcBgFreeBlocks) && (virtualDieMapPtr->die[dieNo].freeBlockCnt > RESERVED_FREE_BLOCK_COUNT) &&
+			PeekGcVictimInvalidCnt(dieNo);
+}
+
+// a die below the watermark is left alone while it still works on queued requests
+static unsigned int BackgroundGcReady(unsigned int dieNo)
+{
+	unsigned int chNo = Vdie2PchTranslation(dieNo);
+	unsigned int wayNo = Vdie2PwayTranslation(dieNo);
+	unsigned int validSliceCnt;
+
+	if((nandReqQ[chNo][wayNo].headReq != REQ_SLOT_TAG_NONE) || (blockedByRowAddrDepReqQ[chNo][wayNo].headReq != REQ_SLOT_TAG_NONE))
+		return 0;
+
+	// the copies and the erase of the step must not use up the requests host commands are waiting for
+	if(gcDieState[dieNo].victimBlock != BLOCK_NONE)
+		validSliceCnt = SLICES_PER_BLOCK - virtualBlockMapPtr->block[dieNo][gcDieState[dieNo].victimBlock].invalidSliceCnt;
+	else
+		validSliceCnt = SLICES_PER_BLOCK - PeekGcVictimInvalidCnt(dieNo);
+	if(validSliceCnt > gcCopiesPerStep)
+		validSliceCnt = gcCopiesPerStep;
+	return freeReqQ.reqCnt >= 2 * validSliceCnt + 1 + AVAILABLE_OUNTSTANDING_REQ_COUNT / 2;
+}
+
+unsigned int BackgroundGcPending()
+{
+	unsigned int dieNo;
+
+	if(!gcBgFreeBlocks)
+		return 0;
+	for(dieNo = 0; dieNo < USER_DIES; dieNo++)
+		if((gcDieState[dieNo].victimBlock != BLOCK_NONE) || BackgroundGcWanted(dieNo))
+			return 1;
+	return 0;
+}
+
+// called when no host command was fetched, one GC step on the next idle die that is collecting or below the watermark
+void BackgroundGarbageCollection()
+{
+	static unsigned int nextDieNo = 0;
+	unsigned int i, dieNo;
+
+	if(!gcBgFreeBlocks)
+		return;
+
+	for(i = 0; i < USER_DIES; i++)
+	{
+		dieNo = (nextDieNo + i) % USER_DIES;
+		if(((gcDieState[dieNo].victimBlock != BLOCK_NONE) || BackgroundGcWanted(dieNo)) && BackgroundGcReady(dieNo))
+		{
+			nextDieNo = (dieNo + 1) % USER_DIES;
+			if(gcDieState[dieNo].victimBlock == BLOCK_NONE)
+				g_ts_gc_bg_runs++;
+			GarbageCollectionStep(dieNo, gcCopiesPerStep);
+			return;
+		}
+	}
+}
+#endif
+
+
+#if 1 //jy
+/*
+ * Index of the age-aware policies. The blocks of a bucket are split into
+ * groups of one erase count, and a block joins the tail of its group
+ * whenever its g_last_update_tick is set, so each group is in age order.
+ * The head of a group then scores highest of the group under cb and cat
+ * alike, and a pick only scores group heads: one per (invalid count, erase
+ * count) pair on the die, however many blocks the die has.
+ */
+#define GC_GROUP_NONE	0xffff
+
+typedef struct _GC_VICTIM_GROUP {
+	unsigned short eraseCnt;
+	unsigned short headBlock;
+	unsigned short tailBlock;
+	unsigned short nextGroup;		// next group of the bucket, or next free group
+} GC_VICTIM_GROUP;
+
+static unsigned int gcVictimIndexed;
+static GC_VICTIM_GROUP gcGroup[USER_DIES][USER_BLOCKS_PER_DIE];	// a group holds a block at least
+static unsigned short gcFreeGroup[USER_DIES];
+static unsigned short gcBucketGroup[USER_DIES][SLICES_PER_BLOCK + 1];
+static unsigned short gcBlockGroup[USER_DIES][USER_BLOCKS_PER_DIE];		// GC_GROUP_NONE outside the victim lists
+static unsigned short gcGroupPrevBlock[USER_DIES][USER_BLOCKS_PER_DIE];
+static unsigned short gcGroupNextBlock[USER_DIES][USER_BLOCKS_PER_DIE];
+
+static void PutToGcVictimIndex(unsigned int dieNo, unsigned int blockNo, unsigned int invalidSliceCnt)
+{
+	unsigned int groupNo, tailBlock;
+	unsigned int eraseCnt = virtualBlockMapPtr->block[dieNo][blockNo].eraseCnt;
+
+	for(groupNo = gcBucketGroup[dieNo][invalidSliceCnt]; groupNo != GC_GROUP_NONE; groupNo = gcGroup[dieNo][groupNo].nextGroup)
+		if(gcGroup[dieNo][groupNo].eraseCnt == eraseCnt)
+			break;
+	if(groupNo == GC_GROUP_NONE)
+	{
+		groupNo = gcFreeGroup[dieNo];
+		gcFreeGroup[dieNo] = gcGroup[dieNo][groupNo].nextGroup;
+		gcGroup[dieNo][groupNo].eraseCnt = eraseCnt;
+		gcGroup[dieNo][groupNo].headBlock = BLOCK_NONE;
+		gcGroup[dieNo][groupNo].tailBlock = BLOCK_NONE;
+		gcGroup[dieNo][groupNo].nextGroup = gcBucketGroup[dieNo][invalidSliceCnt];
+		gcBucketGroup[dieNo][invalidSliceCnt] = groupNo;
+	}
+
+	tailBlock = gcGroup[dieNo][groupNo].tailBlock;
+	gcBlockGroup[dieNo][blockNo] = groupNo;
+	gcGroupPrevBlock[dieNo][blockNo] = tailBlock;
+	gcGroupNextBlock[dieNo][blockNo] = BLOCK_NONE;
+	if(tailBlock != BLOCK_NONE)
+		gcGroupNextBlock[dieNo][tailBlock] = blockNo;
+	else
+		gcGroup[dieNo][groupNo].headBlock = blockNo;
+	gcGroup[dieNo][groupNo].tailBlock = blockNo;
+}
+
+static void GetFromGcVictimIndex(unsigned int dieNo, unsigned int blockNo, unsigned int invalidSliceCnt)
+{
+	unsigned int groupNo, prevBlock, nextBlock;
+	unsigned short *link;
+
+	// InvalidateOldVsa() unlinks blocks without invalid slices too, which are in no list
+	groupNo = gcBlockGroup[dieNo][blockNo];
+	if(groupNo == GC_GROUP_NONE)
+		return;
+	prevBlock = gcGroupPrevBlock[dieNo][blockNo];
+	nextBlock = gcGroupNextBlock[dieNo][blockNo];
+	if(prevBlock != BLOCK_NONE)
+		gcGroupNextBlock[dieNo][prevBlock] = nextBlock;
+	else
+		gcGroup[dieNo][groupNo].headBlock = nextBlock;
+	if(nextBlock != BLOCK_NONE)
+		gcGroupPrevBlock[dieNo][nextBlock] = prevBlock;
+	else
+		gcGroup[dieNo][groupNo].tailBlock = prevBlock;
+	gcBlockGroup[dieNo][blockNo] = GC_GROUP_NONE;
+
+	if(gcGroup[dieNo][groupNo].headBlock != BLOCK_NONE)
+		return;
+	for(link = &gcBucketGroup[dieNo][invalidSliceCnt]; *link != groupNo; link = &gcGroup[dieNo][*link].nextGroup)
+		;
+	*link = gcGroup[dieNo][groupNo].nextGroup;
+	gcGroup[dieNo][groupNo].nextGroup = gcFreeGroup[dieNo];
+	gcFreeGroup[dieNo] = groupNo;
+}
+
+static unsigned int gcSortDieNo;
+
+static int CompareBlockAge(const void *a, const void *b)
+{
+	unsigned int tickA = g_last_update_tick[gcSortDieNo][*(const unsigned short *)a];
+	unsigned int tickB = g_last_update_tick[gcSortDieNo][*(const unsigned short *)b];
+
+	return (tickA > tickB) - (tickA < tickB);
+}
+
+/*
+ * Builds the index from the victim lists for cb and cat, once the FTL maps
+ * are in place (after a precondition or a restored snapshot). From then on
+ * the list functions and UpdateGcVictimIndex() keep it in step.
+ */
+void InitGcVictimIndex()
+{
+	static unsigned short blocks[USER_BLOCKS_PER_DIE];
+	unsigned int dieNo, blockNo, groupNo, invalidSliceCnt, nblocks, i;
+
+	gcVictimIndexed = (gcVictimPolicy == GC_VICTIM_CB) || (gcVictimPolicy == GC_VICTIM_CAT);
+	if(!gcVictimIndexed)
+		return;
+
+	for(dieNo = 0; dieNo < USER_DIES; dieNo++)
+	{
+		for(groupNo = 0; groupNo < USER_BLOCKS_PER_DIE; groupNo++)
+			gcGroup[dieNo][groupNo].nextGroup = (groupNo + 1 < USER_BLOCKS_PER_DIE) ? groupNo + 1 : GC_GROUP_NONE;
+		gcFreeGroup[dieNo] = 0;
+		for(invalidSliceCnt = 0; invalidSliceCnt <= SLICES_PER_BLOCK; invalidSliceCnt++)
+			gcBucketGroup[dieNo][invalidSliceCnt] = GC_GROUP_NONE;
+		for(blockNo = 0; blockNo < USER_BLOCKS_PER_DIE; blockNo++)
+			gcBlockGroup[dieNo][blockNo] = GC_GROUP_NONE;
+
+		// oldest first, so every group comes out in age order
+		nblocks = 0;
+		for(invalidSliceCnt = 1; invalidSliceCnt <= SLICES_PER_BLOCK; invalidSliceCnt++)
+			for(blockNo = gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock; blockNo != BLOCK_NONE;
+					blockNo = virtualBlockMapPtr->block[dieNo][blockNo].nextBlock)
+				blocks[nblocks++] = blockNo;
+		gcSortDieNo = dieNo;
+		qsort(blocks, nblocks, sizeof(blocks[0]), CompareBlockAge);
+		for(i = 0; i < nblocks; i++)
+			PutToGcVictimIndex(dieNo, blocks[i], virtualBlockMapPtr->block[dieNo][blocks[i]].invalidSliceCnt);
+	}
+}
+
+// a write just set the block's g_last_update_tick, it is now the youngest of its group
+void UpdateGcVictimIndex(unsigned int dieNo, unsigned int blockNo)
+{
+	unsigned int invalidSliceCnt;
+
+	if(!gcVictimIndexed || (gcBlockGroup[dieNo][blockNo] == GC_GROUP_NONE))
+		return;
+	invalidSliceCnt = virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt;
+	GetFromGcVictimIndex(dieNo, blockNo, invalidSliceCnt);
+	PutToGcVictimIndex(dieNo, blockNo, invalidSliceCnt);
+}
+#endif
 
 void PutToGcVictimList(unsigned int dieNo, unsigned int blockNo, unsigned int invalidSliceCnt)
 {
+#if 1 //jy
+	// the caller has just set the block's g_last_update_tick, so it is the youngest of its group
+	if(gcVictimIndexed)
+		PutToGcVictimIndex(dieNo, blockNo, invalidSliceCnt);
+#endif
 	if(gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].tailBlock != BLOCK_NONE)
 	{
 		virtualBlockMapPtr->block[dieNo][blockNo].prevBlock = gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].tailBlock;
@@ -153,16 +572,93 @@ void PutToGcVictimList(unsigned int dieNo, unsigned int blockNo, unsigned int in
 	}
 }
 
+#if 1 //jy
+// cb and cat over the heads of the index groups, see InitGcVictimIndex()
+static unsigned int SelectAgeAwareVictim(unsigned int dieNo)
+{
+	unsigned int invalidSliceCnt, groupNo, blockNo, victimBlockNo;
+	double utilization, score, bestScore;
+
+	victimBlockNo = BLOCK_NONE;
+	bestScore = -1;
+	for(invalidSliceCnt = 1; invalidSliceCnt < SLICES_PER_BLOCK; invalidSliceCnt++)
+	{
+		utilization = (double)(SLICES_PER_BLOCK - invalidSliceCnt) / SLICES_PER_BLOCK;
+
+		for(groupNo = gcBucketGroup[dieNo][invalidSliceCnt]; groupNo != GC_GROUP_NONE; groupNo = gcGroup[dieNo][groupNo].nextGroup)
+		{
+			blockNo = gcGroup[dieNo][groupNo].headBlock;
+			score = (double)(g_cb_tick - g_last_update_tick[dieNo][blockNo] + 1) * (1 - utilization) / (2 * utilization);
+			if(gcVictimPolicy == GC_VICTIM_CAT)
+				score = score * 2 / (gcGroup[dieNo][groupNo].eraseCnt + 1);
+			if(score > bestScore)
+			{
+				bestScore = score;
+				victimBlockNo = blockNo;
+			}
+		}
+	}
+	return victimBlockNo;
+}
+
+// blocks in some gcVictimList bucket
+static unsigned int IsGcVictimCandidate(unsigned int dieNo, unsigned int blockNo)
+{
+	return !virtualBlockMapPtr->block[dieNo][blockNo].bad && !virtualBlockMapPtr->block[dieNo][blockNo].free &&
+			virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt && (blockNo != gcDieState[dieNo].victimBlock);
+}
+
+// BLOCK_NONE when the samples found no candidate, the die then falls back to greedy
+static unsigned int SelectRandomizedGreedyVictim(unsigned int dieNo)
+{
+	unsigned int samples, tries, blockNo, victimBlockNo;
+
+	victimBlockNo = BLOCK_NONE;
+	for(samples = 0, tries = 0; (samples < gcVictimWindow) && (tries < 4 * gcVictimWindow); tries++)
+	{
+		blockNo = rng_below(&gcRng, USER_BLOCKS_PER_DIE);
+		if(!IsGcVictimCandidate(dieNo, blockNo))
+			continue;
+		samples++;
+		if((victimBlockNo == BLOCK_NONE) ||
+				(virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt > virtualBlockMapPtr->block[dieNo][victimBlockNo].invalidSliceCnt))
+			victimBlockNo = blockNo;
+	}
+	return victimBlockNo;
+}
+#endif
+
 unsigned int GetFromGcVictimList(unsigned int dieNo)
 {
 	unsigned int evictedBlockNo;
 	int invalidSliceCnt;
 
+#if 1 //jy
+	// a block without valid slices costs nothing under any policy
+	if((gcVictimPolicy != GC_VICTIM_GREEDY) && (gcVictimMapPtr->gcVictimList[dieNo][SLICES_PER_BLOCK].headBlock == BLOCK_NONE))
+	{
+		if(gcVictimPolicy == GC_VICTIM_RGREEDY)
+			evictedBlockNo = SelectRandomizedGreedyVictim(dieNo);
+		else
+			evictedBlockNo = SelectAgeAwareVictim(dieNo);
+
+		if(evictedBlockNo != BLOCK_NONE)
+		{
+			SelectiveGetFromGcVictimList(dieNo, evictedBlockNo);
+			return evictedBlockNo;
+		}
+	}
+#endif
+
 	for(invalidSliceCnt = SLICES_PER_BLOCK; invalidSliceCnt > 0 ; invalidSliceCnt--)
 	{
 		if(gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock != BLOCK_NONE)
 		{
 			evictedBlockNo = gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock;
+#if 1 //jy
+			if(gcVictimIndexed)
+				GetFromGcVictimIndex(dieNo, evictedBlockNo, invalidSliceCnt);
+#endif
 
 			if(virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock != BLOCK_NONE)
 			{
@@ -192,6 +688,10 @@ void SelectiveGetFromGcVictimList(unsigned int dieNo, unsigned int blockNo)
 	nextBlock = virtualBlockMapPtr->block[dieNo][blockNo].nextBlock;
 	prevBlock = virtualBlockMapPtr->block[dieNo][blockNo].prevBlock;
 	invalidSliceCnt = virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt;
+#if 1 //jy
+	if(gcVictimIndexed)
+		GetFromGcVictimIndex(dieNo, blockNo, invalidSliceCnt);
+#endif
 
 	if((nextBlock != BLOCK_NONE) && (prevBlock != BLOCK_NONE))
 	{
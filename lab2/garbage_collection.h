@@ -48,6 +48,7 @@
 #define GARBAGE_COLLECTION_H_
 
 #include "ftl_config.h"
+#include "sim_rand.h" /* jy */
 
 typedef struct _GC_VICTIM_LIST_ENTRY {
 	unsigned int headBlock : 16;
@@ -58,8 +59,32 @@ typedef struct _GC_VICTIM_MAP {
 	GC_VICTIM_LIST_ENTRY gcVictimList[USER_DIES][SLICES_PER_BLOCK + 1];
 } GC_VICTIM_MAP, *P_GC_VICTIM_MAP;
 
+#if 1 //jy
+#define GC_VICTIM_GREEDY		0	// most invalid slices
+#define GC_VICTIM_CB			1	// cost-benefit, age * (1 - u) / 2u
+#define GC_VICTIM_CAT			2	// cost-age-times, age * (1 - u) / (u * erases)
+#define GC_VICTIM_RGREEDY		3	// most invalid slices of gcVictimWindow blocks picked at random
+#define GC_VICTIM_POLICIES		4
+
+// GC of a die between steps, see GarbageCollectionStep()
+typedef struct _GC_DIE_STATE {
+	unsigned int victimBlock : 16;		// BLOCK_NONE when no GC is in progress
+	unsigned int nextPage : 16;			// first page of the victim not looked at yet
+	unsigned int copiedSliceCnt : 16;
+	unsigned int reserved0 : 16;
+} GC_DIE_STATE, *P_GC_DIE_STATE;
+#endif
+
 void InitGcVictimMap();
 void GarbageCollection(unsigned int dieNo);
+#if 1 //jy
+unsigned int GarbageCollectionStep(unsigned int dieNo, unsigned int maxCopies);
+void FinishGarbageCollection();
+void BackgroundGarbageCollection();
+unsigned int BackgroundGcPending();
+void InitGcVictimIndex();
+void UpdateGcVictimIndex(unsigned int dieNo, unsigned int blockNo);
+#endif
 
 void PutToGcVictimList(unsigned int dieNo, unsigned int blockNo, unsigned int invalidSliceCnt);
 unsigned int GetFromGcVictimList(unsigned int dieNo);
@@ -68,5 +93,14 @@ void SelectiveGetFromGcVictimList(unsigned int dieNo, unsigned int blockNo);
 extern P_GC_VICTIM_MAP gcVictimMapPtr;
 extern unsigned int gcTriggered;
 extern unsigned int copyCnt;
+#if 1 //jy
+extern unsigned int gcBgFreeBlocks;
+extern unsigned int gcCopiesPerStep;
+extern GC_DIE_STATE gcDieState[USER_DIES];
+extern unsigned int gcVictimPolicy;
+extern unsigned int gcVictimWindow;
+extern const char *gcVictimPolicyNames[GC_VICTIM_POLICIES];
+extern struct rng gcRng;
+#endif
 
 #endif /* GARBAGE_COLLECTION_H_ */
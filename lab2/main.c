@@ -72,6 +72,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "sim_backend.h"
+#include "sim_timing.h"
+#include "sim_stall.h"
 #endif
 #include "nvme/debug.h"
 
@@ -142,6 +144,8 @@ int main(int argc, char *argv[])
 {
 	init_g_timer();
 	init_nand();
+	init_nand_timing();
+	init_stall();
 	nvme_main(argc, argv);
 #endif
 
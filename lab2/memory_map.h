@@ -108,4 +108,15 @@
 
 #define DRAM_END_ADDR						0x3FFFFFFF
 
+#if 1 //jy
+// regions of g_mem backed by the simulator (init_nand), anything else faults
+#define SIM_MEM_REGIONS	{ \
+	{"memory segments", MEMORY_SEGMENTS_START_ADDR, MEMORY_SEGMENTS_END_ADDR}, \
+	{"nvme management", NVME_MANAGEMENT_START_ADDR, NVME_MANAGEMENT_END_ADDR}, \
+	{"ftl management", FTL_MANAGEMENT_START_ADDR, FTL_MANAGEMENT_END_ADDR}, \
+	{"nsc registers", NSC_0_BASEADDR, NSC_0_BASEADDR + NUMBER_OF_CONNECTED_CHANNEL * (XPAR___TIGER4NSC_0_HIGHADDR - XPAR___TIGER4NSC_0_BASEADDR + 1) - 1}, \
+	{"nvme host registers", XPAR___NVMEHOSTCONTROLLER_0_BASEADDR, XPAR___NVMEHOSTCONTROLLER_0_HIGHADDR}, \
+}
+#endif
+
 #endif /* MEMORY_MAP_H_ */
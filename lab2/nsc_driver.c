@@ -52,6 +52,9 @@
 
 unsigned int __attribute__((optimize("O0"))) V2FIsControllerBusy(V2FMCRegisters* dev)
 {
+#if 1 //jy
+	poll_channel_busy(dev);
+#endif
 	volatile unsigned int channelBusy = *((volatile unsigned int*)&(dev->channelBusy));
 
 	return channelBusy;
@@ -61,7 +64,12 @@ void __attribute__((optimize("O0"))) V2FResetSync(V2FMCRegisters* dev, int way)
 {
 	*((volatile unsigned int*)&(dev->waySelection)) = way;
 	*((volatile unsigned int*)&(dev->cmdSelect)) = V2FCommand_Reset;
+#if 1 //jy
+	while (V2FIsControllerBusy(dev))
+		SchedulingNand();
+#else
 	while (V2FIsControllerBusy(dev));
+#endif
 }
 
 void __attribute__((optimize("O0"))) V2FSetFeaturesSync(V2FMCRegisters* dev, int way, unsigned int feature0x02, unsigned int feature0x10, unsigned int feature0x01, unsigned int payLoadAddr)
@@ -77,7 +85,12 @@ void __attribute__((optimize("O0"))) V2FSetFeaturesSync(V2FMCRegisters* dev, int
 	*((volatile unsigned int*)&(dev->waySelection)) = way;
 	*((volatile unsigned int*)&(dev->userData)) = (unsigned int)payload;
 	*((volatile unsigned int*)&(dev->cmdSelect)) = V2FCommand_SetFeatures;
+#if 1 //jy
+	while (V2FIsControllerBusy(dev))
+		SchedulingNand();
+#else
 	while (V2FIsControllerBusy(dev));
+#endif
 }
 
 void __attribute__((optimize("O0"))) V2FGetFeaturesSync(V2FMCRegisters* dev, int way, unsigned int* feature0x01, unsigned int* feature0x02, unsigned int* feature0x10, unsigned int* feature0x30)
@@ -95,7 +108,12 @@ void __attribute__((optimize("O0"))) V2FGetFeaturesSync(V2FMCRegisters* dev, int
 	*((volatile unsigned int*)&(dev->completionAddress)) = (unsigned int)&completion;
 #endif
 	*((volatile unsigned int*)&(dev->cmdSelect)) = V2FCommand_GetFeatures;
+#if 1 //jy
+	while (V2FIsControllerBusy(dev))
+		SchedulingNand();
+#else
 	while (V2FIsControllerBusy(dev));
+#endif
 	while (!(completion & 1));
 	*feature0x01 = buffer[0];
 	*feature0x02 = buffer[1];
@@ -428,12 +428,21 @@ void push_dma_command(unsigned int direction, unsigned int fifoTail) {
 }
 
 #endif
+#if 1 //jy
+//blockCnt contiguous 4KB blocks from cmd4KBOffset on the host and devAddr on the device, completed as one fifo entry
+void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int blockCnt, unsigned int autoCompletion)
+#else
 void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int autoCompletion)
+#endif
 {
 	HOST_DMA_CMD_FIFO_REG hostDmaReg;
 	unsigned char tempTail;
 
 	ASSERT(cmd4KBOffset < 256);
+#if 1 //jy
+	ASSERT(blockCnt > 0 && blockCnt < 128);
+	ASSERT(cmd4KBOffset + blockCnt <= 256);
+#endif
 	
 	g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
 	while((g_hostDmaStatus.fifoTail.autoDmaTx + 1) % 256 == g_hostDmaStatus.fifoHead.autoDmaTx)
@@ -445,6 +454,9 @@ void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigne
 	hostDmaReg.dmaType = HOST_DMA_AUTO_TYPE;
 	hostDmaReg.dmaDirection = HOST_DMA_TX_DIRECTION;
 	hostDmaReg.cmd4KBOffset = cmd4KBOffset;
+#if 1 //jy
+	hostDmaReg.sgBlockCnt = blockCnt;
+#endif
 	hostDmaReg.cmdSlotTag = cmdSlotTag;
 	hostDmaReg.autoCompletion = autoCompletion;
 
@@ -464,12 +476,21 @@ void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigne
 	g_hostDmaStatus.autoDmaTxCnt++;
 }
 
+#if 1 //jy
+//blockCnt contiguous 4KB blocks from cmd4KBOffset on the host and devAddr on the device, completed as one fifo entry
+void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int blockCnt, unsigned int autoCompletion)
+#else
 void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int autoCompletion)
+#endif
 {
 	HOST_DMA_CMD_FIFO_REG hostDmaReg;
 	unsigned char tempTail;
 
 	ASSERT(cmd4KBOffset < 256);
+#if 1 //jy
+	ASSERT(blockCnt > 0 && blockCnt < 128);
+	ASSERT(cmd4KBOffset + blockCnt <= 256);
+#endif
 	
 	g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
 	while((g_hostDmaStatus.fifoTail.autoDmaRx + 1) % 256 == g_hostDmaStatus.fifoHead.autoDmaRx)
@@ -481,6 +502,9 @@ void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigne
 	hostDmaReg.dmaType = HOST_DMA_AUTO_TYPE;
 	hostDmaReg.dmaDirection = HOST_DMA_RX_DIRECTION;
 	hostDmaReg.cmd4KBOffset = cmd4KBOffset;
+#if 1 //jy
+	hostDmaReg.sgBlockCnt = blockCnt;
+#endif
 	hostDmaReg.cmdSlotTag = cmdSlotTag;
 	hostDmaReg.autoCompletion = autoCompletion;
 
@@ -291,7 +291,12 @@ typedef struct _HOST_DMA_CMD_FIFO_REG
 				unsigned int dmaLen				:13;
 				unsigned int autoCompletion		:1;
 				unsigned int cmd4KBOffset		:9;
+#if 1 //jy
+				//simulator only, the hardware moves one 4KB block per auto dma and keeps these bits reserved
+				unsigned int sgBlockCnt			:7;//auto dma: 4KB blocks in one descriptor, 0 means 1
+#else
 				unsigned int reserved0			:7;//slot_modified
+#endif
 				unsigned int dmaDirection		:1;
 				unsigned int dmaType			:1;
 			};
@@ -362,9 +367,15 @@ void set_direct_tx_dma(unsigned int devAddr, unsigned int pcieAddrH, unsigned in
 
 void set_direct_rx_dma(unsigned int devAddr, unsigned int pcieAddrH, unsigned int pcieAddrL, unsigned int len);
 
+#if 1 //jy
+void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int blockCnt, unsigned int autoCompletion);
+
+void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int blockCnt, unsigned int autoCompletion);
+#else
 void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int autoCompletion);
 
 void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int autoCompletion);
+#endif
 
 void set_link_width(unsigned int linkNum);
 
@@ -223,6 +223,10 @@ void nvme_main()
 		if (ret)
 			exeLlr = 0;
 #endif 
+#if 1 //jy
+		if(exeLlr)
+			BackgroundGarbageCollection();
+#endif
 		if(exeLlr && ((nvmeDmaReqQ.headReq != REQ_SLOT_TAG_NONE) || notCompletedNandReqCnt || blockedReqCnt))
 		{
 			CheckDoneNvmeDmaReq();
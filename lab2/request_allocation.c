@@ -48,6 +48,7 @@
 */
 #include <stdio.h> /* jy */
 #include "sim_backend.h" /* jy */
+#include "sim_stall.h" /* jy */
 #include <assert.h>
 #include "memory_map.h"
 
@@ -163,6 +164,9 @@ unsigned int GetFromFreeReqQ()
 
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType =  REQ_QUEUE_TYPE_NONE;
 	freeReqQ.reqCnt--;
+#if 1 //jy
+	stall_req_alloc(reqSlotTag);
+#endif
 
 	return reqSlotTag;
 }
@@ -234,6 +238,9 @@ void PutToBlockedByBufDepReqQ(unsigned int reqSlotTag)
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType =  REQ_QUEUE_TYPE_BLOCKED_BY_BUF_DEP;
 	blockedByBufDepReqQ.reqCnt++;
 	blockedReqCnt++;
+#if 1 //jy
+	stall_block(reqSlotTag, STALL_BUF_DEP);
+#endif
 }
 void SelectiveGetFromBlockedByBufDepReqQ(unsigned int reqSlotTag)
 {
@@ -269,6 +276,9 @@ void SelectiveGetFromBlockedByBufDepReqQ(unsigned int reqSlotTag)
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType =  REQ_QUEUE_TYPE_NONE;
 	blockedByBufDepReqQ.reqCnt--;
 	blockedReqCnt--;
+#if 1 //jy
+	stall_unblock(reqSlotTag, STALL_BUF_DEP);
+#endif
 }
 
 void PutToBlockedByRowAddrDepReqQ(unsigned int reqSlotTag, unsigned int chNo, unsigned int wayNo)
@@ -291,6 +301,9 @@ void PutToBlockedByRowAddrDepReqQ(unsigned int reqSlotTag, unsigned int chNo, un
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType =  REQ_QUEUE_TYPE_BLOCKED_BY_ROW_ADDR_DEP;
 	blockedByRowAddrDepReqQ[chNo][wayNo].reqCnt++;
 	blockedReqCnt++;
+#if 1 //jy
+	stall_block(reqSlotTag, STALL_ROW_DEP);
+#endif
 }
 void SelectiveGetFromBlockedByRowAddrDepReqQ(unsigned int reqSlotTag, unsigned int chNo, unsigned int wayNo)
 {
@@ -326,6 +339,9 @@ void SelectiveGetFromBlockedByRowAddrDepReqQ(unsigned int reqSlotTag, unsigned i
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NONE;
 	blockedByRowAddrDepReqQ[chNo][wayNo].reqCnt--;
 	blockedReqCnt--;
+#if 1 //jy
+	stall_unblock(reqSlotTag, STALL_ROW_DEP);
+#endif
 }
 
 void PutToNvmeDmaReqQ(unsigned int reqSlotTag)
@@ -404,6 +420,9 @@ void PutToNandReqQ(unsigned int reqSlotTag, unsigned chNo, unsigned wayNo)
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NAND;
 	nandReqQ[chNo][wayNo].reqCnt++;
 	notCompletedNandReqCnt++;
+#if 1 //jy
+	stall_nand_queued(reqSlotTag, chNo, wayNo);
+#endif
 }
 
 void GetFromNandReqQ(unsigned int chNo, unsigned int wayNo, unsigned int reqStatus, unsigned int reqCode)
@@ -428,6 +447,9 @@ void GetFromNandReqQ(unsigned int chNo, unsigned int wayNo, unsigned int reqStat
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NONE;
 	nandReqQ[chNo][wayNo].reqCnt--;
 	notCompletedNandReqCnt--;
+#if 1 //jy
+	stall_nand_done(reqSlotTag, chNo, wayNo);
+#endif
 
 	PutToFreeReqQ(reqSlotTag);
 	ReleaseBlockedByBufDepReq(reqSlotTag);
@@ -110,14 +110,43 @@ void InitReqScheduler()
 
 
 
+#if 1 //jy
+/*
+ * One pass of the Sync* wait loops. A pass that issued no command, retired
+ * no request or host DMA and moved no way between the scheduler lists
+ * changes nothing until the next NAND event, so the clock goes straight
+ * there instead of sweeping the command registers first.
+ */
+static void SyncWaitPass()
+{
+	unsigned long long issued = g_poll.issued, wayMoves = g_poll.way_moves;
+	unsigned int notCompleted = notCompletedNandReqCnt, blocked = blockedReqCnt;
+	unsigned int freeReqs = freeReqQ.reqCnt, dmaReqs = nvmeDmaReqQ.reqCnt;
+
+	g_poll.sync_passes++;
+	CheckDoneNvmeDmaReq();
+	SchedulingNandReq();
+
+	if(g_poll.issued == issued && g_poll.way_moves == wayMoves && notCompleted == notCompletedNandReqCnt && blocked == blockedReqCnt &&
+			freeReqs == freeReqQ.reqCnt && dmaReqs == nvmeDmaReqQ.reqCnt)
+	{
+		g_poll.sync_idle++;
+		timer_warp();
+		return;
+	}
+	SchedulingNand();
+}
+#endif
+
 void SyncAllLowLevelReqDone()
 {
 	while((nvmeDmaReqQ.headReq != REQ_SLOT_TAG_NONE) || notCompletedNandReqCnt || blockedReqCnt)
 	{
+#if 1 //jy
+		SyncWaitPass();
+#else
 		CheckDoneNvmeDmaReq();
 		SchedulingNandReq();
-#if 1 //jy
-		SchedulingNand();
 #endif
 	}
 }
@@ -126,10 +155,11 @@ void SyncAvailFreeReq()
 {
 	while(freeReqQ.headReq == REQ_SLOT_TAG_NONE)
 	{
+#if 1 //jy
+		SyncWaitPass();
+#else
 		CheckDoneNvmeDmaReq();
 		SchedulingNandReq();
-#if 1 //jy
-		SchedulingNand();
 #endif
 	}
 }
@@ -138,10 +168,11 @@ void SyncReleaseEraseReq(unsigned int chNo, unsigned int wayNo, unsigned int blo
 {
 	while(rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedEraseReqFlag)
 	{
+#if 1 //jy
+		SyncWaitPass();
+#else
 		CheckDoneNvmeDmaReq();
 		SchedulingNandReq();
-#if 1 //jy
-		SchedulingNand();
 #endif
 	}
 }
@@ -366,6 +397,9 @@ void PutToNandIdleList(unsigned int chNo, unsigned int wayNo)
 		wayPriorityTablePtr->wayPriority[chNo].idleHead = wayNo;
 		wayPriorityTablePtr->wayPriority[chNo].idleTail = wayNo;
 	}
+#if 1 //jy
+	g_poll.way_moves++;
+#endif
 }
 
 
@@ -411,6 +445,9 @@ void PutToNandStatusReportList(unsigned int chNo, unsigned int wayNo)
 		wayPriorityTablePtr->wayPriority[chNo].statusReportHead = wayNo;
 		wayPriorityTablePtr->wayPriority[chNo].statusReportTail = wayNo;
 	}
+#if 1 //jy
+	g_poll.way_moves++;
+#endif
 }
 
 void SelectivGetFromNandStatusReportList(unsigned int chNo, unsigned int wayNo)
@@ -625,6 +662,9 @@ void PutToNandStatusCheckList(unsigned int chNo, unsigned int wayNo)
 		wayPriorityTablePtr->wayPriority[chNo].statusCheckHead = wayNo;
 		wayPriorityTablePtr->wayPriority[chNo].statusCheckTail = wayNo;
 	}
+#if 1 //jy
+	g_poll.way_moves++;
+#endif
 }
 
 void SelectiveGetFromNandStatusCheckList(unsigned int chNo, unsigned int wayNo)
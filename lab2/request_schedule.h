@@ -53,7 +53,11 @@
 #define WAY_NONE 			0xF
 
 #define LUN_0_BASE_ADDR		0x00000000
+#if 1 //jy
+#define LUN_1_BASE_ADDR		0x00400000	// TOTAL_BLOCKS_PER_LUN * 512 rows no longer fits below 0x00200000
+#else
 #define LUN_1_BASE_ADDR		0x00200000
+#endif
 
 #define PSEUDO_BAD_BLOCK_MARK	0
 
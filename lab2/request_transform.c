@@ -51,6 +51,7 @@
 */
 #include <stdio.h> /* jy */
 #include "sim_backend.h" /* jy */
+#include "sim_stall.h" /* jy */
 #include <assert.h>
 #include "nvme/nvme.h"
 #include "nvme/host_lld.h"
@@ -162,6 +163,53 @@ void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigne
 
 
 
+#if 1 //jy
+static void WriteBackDataBufEntry(unsigned int dataBufEntry, unsigned int nvmeCmdSlotTag)
+{
+	unsigned int reqSlotTag, virtualSliceAddr;
+
+	reqSlotTag = GetFromFreeReqQ();
+	virtualSliceAddr =  AddrTransWrite(dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr);
+
+	reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
+	reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_WRITE;
+	reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag = nvmeCmdSlotTag;
+	reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_ENTRY;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
+	reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
+	UpdateDataBufEntryInfoBlockingReq(dataBufEntry, reqSlotTag);
+	reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
+
+	SelectLowLevelReqQ(reqSlotTag);
+
+	dataBufMapPtr->dataBuf[dataBufEntry].dirty = DATA_BUF_CLEAN;
+}
+
+void EvictDataBufEntry(unsigned int originReqSlotTag)
+{
+	unsigned int dataBufEntry;
+
+	dataBufEntry = reqPoolPtr->reqPool[originReqSlotTag].dataBufInfo.entry;
+	if(dataBufMapPtr->dataBuf[dataBufEntry].dirty == DATA_BUF_DIRTY)
+		WriteBackDataBufEntry(dataBufEntry, reqPoolPtr->reqPool[originReqSlotTag].nvmeCmdSlotTag);
+}
+
+//program every dirty entry so the maps cover all completed host writes, the entries stay cached as clean
+//no host command is in flight when this is called, the writes belong to none
+void FlushDataBuf()
+{
+	unsigned int dataBufEntry;
+
+	for(dataBufEntry = 0; dataBufEntry < AVAILABLE_DATA_BUFFER_ENTRY_COUNT; dataBufEntry++)
+		if(dataBufMapPtr->dataBuf[dataBufEntry].dirty == DATA_BUF_DIRTY)
+			WriteBackDataBufEntry(dataBufEntry, NVME_CMD_SLOT_TAG_FLUSH);
+}
+#else
 void EvictDataBufEntry(unsigned int originReqSlotTag)
 {
 	unsigned int reqSlotTag, virtualSliceAddr, dataBufEntry;
@@ -191,6 +239,7 @@ void EvictDataBufEntry(unsigned int originReqSlotTag)
 		dataBufMapPtr->dataBuf[dataBufEntry].dirty = DATA_BUF_CLEAN;
 	}
 }
+#endif
 
 void DataReadFromNand(unsigned int originReqSlotTag)
 {
@@ -307,7 +356,15 @@ unsigned int CheckRowAddrDep(unsigned int reqSlotTag, unsigned int checkRowAddrD
 		if(checkRowAddrDepOpt == ROW_ADDR_DEPENDENCY_CHECK_OPT_SELECT)
 		{
 			if(rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedEraseReqFlag)
+#if 1 //jy
+			{
+				stall_block(reqSlotTag, STALL_ERASE);
 				SyncReleaseEraseReq(chNo, wayNo, blockNo);
+				stall_unblock(reqSlotTag, STALL_ERASE);
+			}
+#else
+				SyncReleaseEraseReq(chNo, wayNo, blockNo);
+#endif
 
 			if(pageNo < rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].permittedProgPage)
 				return ROW_ADDR_DEPENDENCY_REPORT_PASS;
@@ -380,7 +437,13 @@ unsigned int UpdateRowAddrDepTableForBufBlockedReq(unsigned int reqSlotTag)
 	{
 		if(rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedEraseReqFlag)
 		{
+#if 1 //jy
+			stall_block(reqSlotTag, STALL_ERASE);
+			SyncReleaseEraseReq(chNo, wayNo, blockNo);
+			stall_unblock(reqSlotTag, STALL_ERASE);
+#else
 			SyncReleaseEraseReq(chNo, wayNo, blockNo);
+#endif
 
 			bufDepCheckReport = CheckBufDep(reqSlotTag);
 			if(bufDepCheckReport == BUF_DEPENDENCY_REPORT_PASS)
@@ -581,10 +644,18 @@ void IssueNvmeDmaReq(unsigned int reqSlotTag)
 
 	dmaIndex = reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.startIndex;
 	devAddr = GenerateDataBufAddr(reqSlotTag);
+#if 1 //jy
+	numOfNvmeBlock = reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock;
+#else
 	numOfNvmeBlock = 0;
+#endif
 
 	if(reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_RxDMA)
 	{
+#if 1 //jy
+		//the blocks of a slice are contiguous on both sides, one scatter-gather descriptor moves them all
+		set_auto_rx_dma(reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag, dmaIndex, devAddr, numOfNvmeBlock, NVME_COMMAND_AUTO_COMPLETION_ON);
+#else
 		while(numOfNvmeBlock < reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock)
 		{
 			set_auto_rx_dma(reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag, dmaIndex, devAddr, NVME_COMMAND_AUTO_COMPLETION_ON);
@@ -593,11 +664,15 @@ void IssueNvmeDmaReq(unsigned int reqSlotTag)
 			dmaIndex++;
 			devAddr += BYTES_PER_NVME_BLOCK;
 		}
+#endif
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.reqTail = g_hostDmaStatus.fifoTail.autoDmaRx;
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.overFlowCnt = g_hostDmaAssistStatus.autoDmaRxOverFlowCnt;
 	}
 	else if(reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_TxDMA)
 	{
+#if 1 //jy
+		set_auto_tx_dma(reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag, dmaIndex, devAddr, numOfNvmeBlock, NVME_COMMAND_AUTO_COMPLETION_ON);
+#else
 		while(numOfNvmeBlock < reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock)
 		{
 			set_auto_tx_dma(reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag, dmaIndex, devAddr, NVME_COMMAND_AUTO_COMPLETION_ON);
@@ -606,6 +681,7 @@ void IssueNvmeDmaReq(unsigned int reqSlotTag)
 			dmaIndex++;
 			devAddr += BYTES_PER_NVME_BLOCK;
 		}
+#endif
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.reqTail =  g_hostDmaStatus.fifoTail.autoDmaTx;
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.overFlowCnt = g_hostDmaAssistStatus.autoDmaTxOverFlowCnt;
 	}
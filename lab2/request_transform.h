@@ -85,6 +85,11 @@ void CheckDoneNvmeDmaReq();
 void SelectLowLevelReqQ(unsigned int reqSlotTag);
 void ReleaseBlockedByBufDepReq(unsigned int reqSlotTag);
 void ReleaseBlockedByRowAddrDepReq(unsigned int chNo, unsigned int wayNo);
+#if 1 //jy
+#define NVME_CMD_SLOT_TAG_FLUSH		0xffff	// FlushDataBuf() write-backs, no host command owns them
+
+void FlushDataBuf();
+#endif
 
 extern P_ROW_ADDR_DEPENDENCY_TABLE rowAddrDependencyTablePtr;
 
@@ -1,21 +1,128 @@
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
-#include <sys/queue.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "sim_backend.h"
+#include "memory_map.h"
+#include "sim_timing.h"
+#include "sim_payload.h"
 #include "nsc_driver.h"
 
 void *g_mem;
 struct timer_pqueue g_timer;
+struct channel_bus g_bus[USER_CHANNELS];
+struct poll_stats g_poll;
+
+static void timer_pool_grow() {
+	struct timer_pqueue_entry *chunk;
+	int i;
+
+	chunk = (struct timer_pqueue_entry *)malloc(sizeof(struct timer_pqueue_entry) * TIMER_POOL_CHUNK);
+	if (!chunk)
+		assert(!"[WARNING]Failed to allocate timer_pqueue_entry pool[WARNING]");
+
+	for (i = 0; i < TIMER_POOL_CHUNK - 1; i++)
+		chunk[i].next_free = &chunk[i + 1];
+	chunk[i].next_free = g_timer.free_list;
+	g_timer.free_list = chunk;
+
+	g_timer.capacity += TIMER_POOL_CHUNK;
+	g_timer.heap = (struct timer_pqueue_entry **)realloc(g_timer.heap, sizeof(struct timer_pqueue_entry *) * g_timer.capacity);
+	if (!g_timer.heap)
+		assert(!"[WARNING]Failed to allocate timer heap[WARNING]");
+}
 
 void init_g_timer() {
-	TAILQ_INIT(&(g_timer.head));
 	g_timer.current_time = 0;
 	g_timer.ongoing = 0;
+	g_timer.next_seq = 0;
+	g_timer.capacity = 0;
+	g_timer.heap = NULL;
+	g_timer.free_list = NULL;
+	g_timer.wake_time = 0;
+	timer_pool_grow();
+
+	memset(g_bus, 0, sizeof(g_bus));
+	memset(&g_poll, 0, sizeof(g_poll));
 }
 
+static const struct mem_region mem_regions[] = SIM_MEM_REGIONS;
+
+#define MEM_REGIONS		(sizeof(mem_regions) / sizeof(mem_regions[0]))
+
+/*
+ * Reserve the 4GB address space without backing it, then open up only the
+ * regions listed in memory_map.h. Pages are committed (zero-filled) on
+ * first touch, so the footprint follows the tables the FTL actually uses.
+ * g_mem is 4GB aligned so the 32-bit buffer pointers the NSC driver writes
+ * into its registers are g_mem offsets.
+ */
 void init_nand() {
-	g_mem = calloc(1, 0x100000000);
+	unsigned long long page = sysconf(_SC_PAGESIZE);
+	unsigned long long start, end;
+	char *base;
+	int i;
+
+	base = mmap(NULL, 2 * G_MEM_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (base == MAP_FAILED)
+		assert(!"[WARNING]Failed to reserve g_mem[WARNING]");
+
+	g_mem = (void *)(((uintptr_t)base + G_MEM_SIZE - 1) & ~(uintptr_t)(G_MEM_SIZE - 1));
+	if ((char *)g_mem > base)
+		munmap(base, (char *)g_mem - base);
+	munmap((char *)g_mem + G_MEM_SIZE, base + G_MEM_SIZE - (char *)g_mem);
+
+	for (i = 0; i < MEM_REGIONS; i++) {
+		start = mem_regions[i].start & ~(page - 1);
+		end = (mem_regions[i].end + page) & ~(page - 1);
+		if (mprotect((char *)g_mem + start, end - start, PROT_READ | PROT_WRITE))
+			assert(!"[WARNING]Failed to map g_mem region[WARNING]");
+	}
+}
+
+static unsigned long long region_resident_bytes(const struct mem_region *region) {
+	unsigned long long page = sysconf(_SC_PAGESIZE);
+	unsigned long long start, end, npages, i, resident = 0;
+	unsigned char *vec;
+
+	start = region->start & ~(page - 1);
+	end = (region->end + page) & ~(page - 1);
+	npages = (end - start) / page;
+
+	vec = (unsigned char *)malloc(npages);
+	if (!vec || mincore((char *)g_mem + start, end - start, vec)) {
+		free(vec);
+		return 0;
+	}
+	for (i = 0; i < npages; i++)
+		resident += vec[i] & 1;
+	free(vec);
+
+	return resident * page;
+}
+
+void show_mem_usage() {
+	char line[128];
+	FILE *fp;
+	int i;
+
+	printf("==== Memory Usage ====\n");
+	for (i = 0; i < MEM_REGIONS; i++)
+		printf("%-20s: %8llu KB resident of %8llu KB\n", mem_regions[i].name,
+				region_resident_bytes(&mem_regions[i]) / 1024,
+				(mem_regions[i].end - mem_regions[i].start + 1) / 1024);
+
+	fp = fopen("/proc/self/status", "r");
+	if (!fp)
+		return;
+	while (fgets(line, sizeof(line), fp)) {
+		if (!strncmp(line, "VmRSS:", 6) || !strncmp(line, "VmHWM:", 6))
+			printf("%s", line);
+	}
+	fclose(fp);
 }
 
 void instant_task_raw(unsigned int ch, unsigned int way, void *completion, unsigned int flag) {
@@ -32,10 +139,12 @@ void instant_task_comp(void *completion, unsigned int flag) {
 }
 
 struct timer_pqueue_entry *task_create_raw(unsigned int ch, unsigned int way, unsigned long long trigger_time, void *completion, unsigned int flag) {
-	struct timer_pqueue_entry *task = (struct timer_pqueue_entry *)malloc(sizeof(struct timer_pqueue_entry));
+	struct timer_pqueue_entry *task;
 
-	if (!task)
-		assert(!"[WARNING]Failed to allocate timer_pqueue_entry[WARNING]");
+	if (!g_timer.free_list)
+		timer_pool_grow();
+	task = g_timer.free_list;
+	g_timer.free_list = task->next_free;
 
 	task->trigger_time = g_timer.current_time + trigger_time;
 	task->ch = ch;
@@ -55,50 +164,109 @@ struct timer_pqueue_entry *task_create(unsigned int ch, unsigned int way, unsign
 	return task_create_raw(ch, way, trigger_time, NULL, 0);
 }
 
+#define TIMER_BEFORE(a, b)	((a)->trigger_time < (b)->trigger_time || \
+							 ((a)->trigger_time == (b)->trigger_time && (a)->seq < (b)->seq))
+
 void timer_put(struct timer_pqueue_entry *task) {
-	struct timer_pqueue_entry *entry;
+	struct timer_pqueue_entry **heap = g_timer.heap;
+	unsigned int idx, parent;
 
 	set_busy(task->ch, task->way);
-	g_timer.ongoing++;
+	task->seq = g_timer.next_seq++;
 
-	if (TAILQ_EMPTY(&(g_timer.head))) {
-		TAILQ_INSERT_HEAD(&(g_timer.head), task, entry);
-		return;
+	idx = g_timer.ongoing++;
+	while (idx) {
+		parent = (idx - 1) / 2;
+		if (!TIMER_BEFORE(task, heap[parent]))
+			break;
+		heap[idx] = heap[parent];
+		idx = parent;
 	}
+	heap[idx] = task;
+}
 
-	TAILQ_FOREACH(entry, &(g_timer.head), entry) {
-		if (entry->trigger_time > task->trigger_time) {
-			TAILQ_INSERT_BEFORE(entry, task, entry);
-			return;
-		}
+static struct timer_pqueue_entry *timer_pop() {
+	struct timer_pqueue_entry **heap = g_timer.heap;
+	struct timer_pqueue_entry *top = heap[0];
+	struct timer_pqueue_entry *last;
+	unsigned int idx = 0, child, n;
+
+	n = --g_timer.ongoing;
+	last = heap[n];
+	while ((child = 2 * idx + 1) < n) {
+		if (child + 1 < n && TIMER_BEFORE(heap[child + 1], heap[child]))
+			child++;
+		if (!TIMER_BEFORE(heap[child], last))
+			break;
+		heap[idx] = heap[child];
+		idx = child;
 	}
+	heap[idx] = last;
 
-	TAILQ_INSERT_TAIL(&(g_timer.head), task, entry);
-	return;
+	return top;
 }
 
 void timer_warp() {
-	struct timer_pqueue_entry *task = TAILQ_FIRST(&(g_timer.head));
-	struct timer_pqueue_entry *next_task;
-  
-   	if (!task)	
+	struct timer_pqueue_entry *task;
+
+	if (TIMER_EMPTY())
+		return;
+	if (g_timer.wake_time > g_timer.current_time && g_timer.wake_time < g_timer.heap[0]->trigger_time) {
+		g_timer.current_time = g_timer.wake_time;
 		return;
+	}
 
+	g_timer.current_time = g_timer.heap[0]->trigger_time;
 	do {
-		next_task = TAILQ_NEXT(task, entry);
+		task = timer_pop();
 
-		g_timer.ongoing--;
-		g_timer.current_time = task->trigger_time;
 		clear_busy(task->ch, task->way);
 		if (task->flag)
 			*((unsigned int *)(task->completion)) = task->flag;
 
-		TAILQ_REMOVE(&(g_timer.head), task, entry);
-		free(task);
-		task = next_task;
-	} while (task && task->trigger_time == g_timer.current_time);
+		task->next_free = g_timer.free_list;
+		g_timer.free_list = task;
+	} while (!TIMER_EMPTY() && g_timer.heap[0]->trigger_time == g_timer.current_time);
+}
+
+/*
+ * Reserve the channel bus for a transfer of "xfer" ticks, starting as soon
+ * as the bus is free. Returns the ticks from now until the transfer ends.
+ */
+unsigned long long bus_reserve(unsigned int ch, unsigned long long xfer) {
+	unsigned long long start = g_timer.current_time;
+
+	if (g_bus[ch].free_time > start) {
+		g_bus[ch].wait_time += g_bus[ch].free_time - start;
+		start = g_bus[ch].free_time;
+	}
+	g_bus[ch].free_time = start + xfer;
+	g_bus[ch].busy_time += xfer;
+	g_bus[ch].xfers++;
 
-	return;
+	return g_bus[ch].free_time - g_timer.current_time;
+}
+
+void show_bus_stats() {
+	unsigned int ch;
+
+	if (!g_nand_timing.bus_mts || !g_timer.current_time)
+		return;
+
+	printf("==== Channel Bus (%u MT/s) ====\n", g_nand_timing.bus_mts);
+	for (ch = 0; ch < USER_CHANNELS; ch++)
+		printf("Ch[%u]: util %.2f%% xfers %llu avg wait %.2f\n", ch,
+				100.0 * g_bus[ch].busy_time / g_timer.current_time, g_bus[ch].xfers,
+				g_bus[ch].xfers ? (double)g_bus[ch].wait_time / g_bus[ch].xfers : 0.0);
+}
+
+void show_poll_stats() {
+	if (!g_poll.sync_passes)
+		return;
+
+	printf("==== Scheduler Polling ====\n");
+	printf("Sync waits      : %llu passes, %llu idle (%.2f%%, clock moved to the next event)\n", g_poll.sync_passes,
+			g_poll.sync_idle, 100.0 * g_poll.sync_idle / g_poll.sync_passes);
 }
 
 void set_busy(unsigned int ch, unsigned int way) {
@@ -109,6 +277,19 @@ void clear_busy(unsigned int ch, unsigned int way) {
 	SET_BIT(chCtlReg[ch]->readyBusy, way);
 }
 
+/*
+ * The NSC raises channelBusy when cmdSelect is written and drops it once it
+ * has taken the command, so the FTL never overwrites a command the channel
+ * hasn't latched. A plain store can't raise it here, so it is raised when
+ * the driver polls it and dropped by SchedulingNand().
+ */
+void poll_channel_busy(V2FMCRegisters *dev) {
+	if (dev->cmdSelect != V2FCommand_NOP && !dev->channelBusy) {
+		dev->channelBusy = 1;
+		g_poll.issued++;
+	}
+}
+
 void SchedulingNand() {
 	int execmd = 0;
 	unsigned int ch, way;
@@ -116,6 +297,7 @@ void SchedulingNand() {
 	struct timer_pqueue_entry *task;
 
 	for (ch = 0; ch < USER_CHANNELS; ch++) {
+		chCtlReg[ch]->channelBusy = 0;
 		switch (chCtlReg[ch]->cmdSelect) {
 			case V2FCommand_NOP:
 				break;
@@ -138,8 +320,7 @@ void SchedulingNand() {
 				break;
 			case V2FCommand_ReadPageTrigger:
 				way = chCtlReg[ch]->waySelection;
-				// row = chCtlReg[ch]->rowAddress;
-				task = task_create(ch, way, 30);
+				task = task_create(ch, way, nand_t_r(chCtlReg[ch]->rowAddress));
 				timer_put(task);
 				chCtlReg[ch]->cmdSelect = V2FCommand_NOP;
 				execmd++;
@@ -152,25 +333,36 @@ void SchedulingNand() {
 				// errorInformation = chCtlReg[ch]->errorCountAddress;
 				completion.low = chCtlReg[ch]->completionAddress;
 				completion.high = chCtlReg[ch]->errorCountAddress;
-				task = task_create_raw(ch, way, 300, completion.addr, 1);
+				if (g_payload.enabled)
+					payload_read(ch, way, chCtlReg[ch]->rowAddress, chCtlReg[ch]->dataAddress, chCtlReg[ch]->spareAddress);
+				if (g_nand_timing.bus_mts)
+					task = task_create_raw(ch, way, bus_reserve(ch, nand_t_xfer(BYTES_PER_NAND_ROW)), completion.addr, 1);
+				else
+					task = task_create_raw(ch, way, nand_t_xfer(BYTES_PER_NAND_ROW), completion.addr, 1);
 				timer_put(task);
 				chCtlReg[ch]->cmdSelect = V2FCommand_NOP;
 				execmd++;
 				break;
 			case V2FCommand_ProgramPage:
 				way = chCtlReg[ch]->waySelection;
-				// row = chCtlReg[ch]->rowAddress;
 				// pageDataBuffer = chCtlReg[ch]->dataAddress;
 				// spareDataBuffer = chCtlReg[ch]->spareAddress;
-				task = task_create(ch, way, 650);
+				if (g_payload.enabled)
+					payload_program(ch, way, chCtlReg[ch]->rowAddress, chCtlReg[ch]->dataAddress, chCtlReg[ch]->spareAddress);
+				// data-in holds the channel, then the die programs on its own
+				if (g_nand_timing.bus_mts)
+					task = task_create(ch, way, bus_reserve(ch, nand_t_xfer(BYTES_PER_NAND_ROW)) + nand_t_prog(chCtlReg[ch]->rowAddress));
+				else
+					task = task_create(ch, way, nand_t_prog(chCtlReg[ch]->rowAddress));
 				timer_put(task);
 				chCtlReg[ch]->cmdSelect = V2FCommand_NOP;
 				execmd++;
 				break;
 			case V2FCommand_BlockErase:
 				way = chCtlReg[ch]->waySelection;
-				// row = chCtlReg[ch]->rowAddress;
-				task = task_create(ch, way, 15000);
+				if (g_payload.enabled)
+					payload_erase(ch, way, chCtlReg[ch]->rowAddress);
+				task = task_create(ch, way, g_nand_timing.t_bers);
 				timer_put(task);
 				chCtlReg[ch]->cmdSelect = V2FCommand_NOP;
 				execmd++;
@@ -184,10 +376,11 @@ void SchedulingNand() {
 				break;
 			case V2FCommand_ReadPageTransferRaw:
 				way = chCtlReg[ch]->waySelection;
-				// pageDataBuffer = chCtlReg[ch]->dataAddress;
 				completion.low = chCtlReg[ch]->completionAddress;
 				completion.high = chCtlReg[ch]->errorCountAddress;
-				task = task_create_raw(ch, way, 5, completion.addr, 1);
+				if (g_payload.enabled)
+					payload_read_raw(ch, way, chCtlReg[ch]->rowAddress, chCtlReg[ch]->dataAddress);
+				task = task_create_raw(ch, way, g_nand_timing.t_raw, completion.addr, 1);
 				timer_put(task);
 				chCtlReg[ch]->cmdSelect = V2FCommand_NOP;
 				execmd++;
@@ -195,7 +388,7 @@ void SchedulingNand() {
 		}
 	}
 
-	if (!execmd && !TAILQ_EMPTY(&(g_timer.head))) {
+	if (!execmd && !TIMER_EMPTY()) {
 		timer_warp();
 	}
 }
@@ -1,36 +1,75 @@
 #ifndef SIM_BACKEND_H_
 #define SIM_BACKEND_H_
 
-#include <sys/queue.h>
 #include "ftl_config.h"
 
 extern void *g_mem;
 extern struct timer_pqueue g_timer;
 
+#define G_MEM_SIZE					0x100000000ULL
+
+struct mem_region {
+	const char *name;
+	unsigned long long start;
+	unsigned long long end;		// inclusive
+};
+
 /* Never put pointer variables into "type" */
 #define Addr2Mem(type, addr)		((type *)((char *)g_mem + (addr)))
 
 #define SET_BIT(x, n)				((x) |= (1 << n))
 #define CLEAR_BIT(x, n)				((x) &= ~(1 << n))
 
+/* entries are carved out of the pool in chunks of this many and never freed */
+#define TIMER_POOL_CHUNK			1024
+
 struct timer_pqueue_entry {
 	unsigned long long trigger_time;
+	unsigned long long seq;		// insertion order, keeps ties FIFO
 	unsigned int ch;
 	unsigned int way;
 	void *completion;
 	unsigned int flag;
-	TAILQ_ENTRY(timer_pqueue_entry) entry;
+	struct timer_pqueue_entry *next_free;
 };
 
-
+/* binary min-heap ordered by (trigger_time, seq) */
 struct timer_pqueue {
 	unsigned long long current_time;
 	unsigned int ongoing;
-	TAILQ_HEAD(timer_pqueue_head, timer_pqueue_entry) head;
+	unsigned long long next_seq;
+	unsigned int capacity;
+	struct timer_pqueue_entry **heap;
+	struct timer_pqueue_entry *free_list;
+	unsigned long long wake_time;	// next host arrival, a warp stops there; 0 if none
 };
 
+#define TIMER_EMPTY()				(g_timer.ongoing == 0)
+
+/* per-channel bus timeline, only used when g_nand_timing.bus_mts is set */
+struct channel_bus {
+	unsigned long long free_time;	// bus is reserved until this tick
+	unsigned long long busy_time;	// total transfer ticks
+	unsigned long long wait_time;	// ticks transfers waited for the bus
+	unsigned long long xfers;
+};
+
+extern struct channel_bus g_bus[USER_CHANNELS];
+
+/* what the FTL's Sync* wait loops did, see SyncWaitPass() */
+struct poll_stats {
+	unsigned long long issued;			// commands the FTL wrote, counted when it polls channelBusy
+	unsigned long long sync_passes;		// passes of the FTL's Sync* wait loops
+	unsigned long long sync_idle;		// of those, nothing changed: straight to the next event
+	unsigned long long way_moves;		// ways put on a scheduler list, one scan can hand a way to the next
+};
+
+extern struct poll_stats g_poll;
+
+
 void init_g_timer();
 void init_nand();
+void show_mem_usage();
 void instant_task_raw(unsigned int ch, unsigned int way, void *completion, unsigned int flag);
 void instant_task(unsigned int ch, unsigned int way);
 void instant_task_comp(void *comletion, unsigned int flag);
@@ -38,8 +77,12 @@ struct timer_pqueue_entry *task_create_raw(unsigned int ch, unsigned int way, un
 struct timer_pqueue_entry *task_create(unsigned int ch, unsigned int way, unsigned long long trigger_time);
 void timer_put(struct timer_pqueue_entry *new_entry);
 void timer_warp();
+unsigned long long bus_reserve(unsigned int ch, unsigned long long xfer);
+void show_bus_stats();
+void show_poll_stats();
 void set_busy(unsigned int ch, unsigned int way);
 void clear_busy(unsigned int ch, unsigned int way);
+void poll_channel_busy(V2FMCRegisters *dev);
 void SchedulingNand();
 
 #endif /* SIM_BACKEND_H_ */
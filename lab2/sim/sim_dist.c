@@ -0,0 +1,95 @@
+#include <math.h>
+
+#include "sim_dist.h"
+
+const char *pattern_names[PATTERNS] = {"seq", "rand", "zipf", "hotcold", "pareto"};
+const double pattern_defaults[PATTERNS][2] = {{0, 0}, {0, 0}, {0.99, 0}, {80, 20}, {0.2, 0}};
+
+/* log1p(x) / x and expm1(x) / x, exact near 0 */
+static double helper1(double x) {
+	return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+static double helper2(double x) {
+	return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+/* h(x) = x^-theta and its integral H(x) = (x^(1-theta) - 1) / (1 - theta), log(x) for theta 1 */
+static double zipf_h(const struct dist *d, double x) {
+	return exp(-d->param[0] * log(x));
+}
+
+static double zipf_hint(const struct dist *d, double x) {
+	double logx = log(x);
+
+	return helper2((1 - d->param[0]) * logx) * logx;
+}
+
+static double zipf_hint_inv(const struct dist *d, double x) {
+	double t = x * (1 - d->param[0]);
+
+	if (t < -1)
+		t = -1;
+	return exp(helper1(t) * x);
+}
+
+void dist_init(struct dist *d, unsigned int type, unsigned long long n, const double *param) {
+	d->type = type;
+	d->n = n ? n : 1;
+	d->param[0] = param[0];
+	d->param[1] = param[1];
+	if (type == PATTERN_ZIPF) {
+		d->h_x1 = zipf_hint(d, 1.5) - 1;
+		d->h_n = zipf_hint(d, d->n + 0.5);
+		d->s = 2 - zipf_hint_inv(d, zipf_hint(d, 2.5) - zipf_h(d, 2));
+	}
+	if (type == PATTERN_PARETO)
+		d->pow = log(param[0]) / log(1 - param[0]);
+}
+
+/* rank 1 ~ n, 1 the most popular */
+static unsigned long long zipf_next(struct dist *d, struct rng *r) {
+	unsigned long long k;
+	double u, x;
+
+	while (1) {
+		u = d->h_n + rng_double(r) * (d->h_x1 - d->h_n);
+		x = zipf_hint_inv(d, u);
+		k = (unsigned long long)(x + 0.5);
+		if (k < 1)
+			k = 1;
+		else if (k > d->n)
+			k = d->n;
+		if (k - x <= d->s || u >= zipf_hint(d, k + 0.5) - zipf_h(d, k))
+			return k;
+	}
+}
+
+/*
+ * Rank n * u^pow: the first fraction f of the ranks gets f^(1/pow) of the
+ * draws, so h of them get 1 - h (the power-law form fio calls pareto).
+ */
+static unsigned long long pareto_next(struct dist *d, struct rng *r) {
+	return (unsigned long long)(d->n * pow(rng_double(r), d->pow)) + 1;
+}
+
+/* unit 0 ~ n - 1 */
+unsigned long long dist_next(struct dist *d, struct rng *r) {
+	unsigned long long hot;
+
+	switch (d->type) {
+	case PATTERN_ZIPF:
+		return (zipf_next(d, r) - 1) * DIST_SCRAMBLE % d->n;
+	case PATTERN_PARETO:
+		return (pareto_next(d, r) - 1) * DIST_SCRAMBLE % d->n;
+	case PATTERN_HOTCOLD:
+		hot = d->n * d->param[1] / 100;
+		if (!hot)
+			hot = 1;
+		if (hot == d->n || rng_double(r) * 100 < d->param[0])
+			return rng_below(r, hot);
+		return hot + rng_below(r, d->n - hot);
+	default:
+		return rng_below(r, d->n);
+	}
+}
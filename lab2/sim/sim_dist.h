@@ -0,0 +1,37 @@
+#ifndef SIM_DIST_H_
+#define SIM_DIST_H_
+
+#include "sim_rand.h"
+
+/* host_config.pattern, the first -w field */
+#define PATTERN_SEQ					0
+#define PATTERN_RAND				1	// uniform
+#define PATTERN_ZIPF				2	// param[0] theta, rank r drawn with weight 1/r^theta
+#define PATTERN_HOTCOLD				3	// param[0]% of the ops go to the first param[1]% of the partition
+#define PATTERN_PARETO				4	// param[0] h, 1 - h of the ops go to the h most popular blocks
+#define PATTERNS					5
+
+#define DIST_SCRAMBLE				2654435761ULL	// prime, spreads the popular ranks over the partition
+
+/*
+ * Skewed picks of one of n units, constant time and no table per unit.
+ * Zipf uses Hoermann and Derflinger's rejection-inversion, which accepts
+ * more than 90% of the first draws for any theta.
+ */
+struct dist {
+	unsigned int type;
+	unsigned long long n;
+	double param[2];
+	double h_x1;				// zipf: H(1.5) - 1
+	double h_n;					// zipf: H(n + 0.5)
+	double s;					// zipf: squeeze, ranks within it are accepted without a test
+	double pow;					// pareto: log(h) / log(1 - h)
+};
+
+extern const char *pattern_names[PATTERNS];
+extern const double pattern_defaults[PATTERNS][2];
+
+void dist_init(struct dist *d, unsigned int type, unsigned long long n, const double *param);
+unsigned long long dist_next(struct dist *d, struct rng *r);
+
+#endif /* SIM_DIST_H_ */
@@ -1,6 +1,8 @@
 #include <stddef.h>
 #include <sys/queue.h>
 #include <stdio.h>
+#include <assert.h>
+#include <string.h>
 
 #include "io_access.h"
 #include "xparameters.h"
@@ -9,10 +11,12 @@
 #include "sim_host.h"
 #include "sim_frontend.h"
 #include "sim_backend.h"
+#include "sim_payload.h"
 
 struct nvme_request_queue fe_req_sq;
 struct nvme_request_queue fe_req_cq;
 struct fe_status fe_stat;
+struct dma_stats g_dma_stats;
 
 void init_fe() {
 	init_fe_req_queues();
@@ -33,6 +37,8 @@ void init_fe_stat() {
 	fe_stat.ongoing = 0;
 	fe_stat.last_rx_tail = 0;
 	fe_stat.last_tx_tail = 0;
+	memset(fe_stat.slot, 0, sizeof(fe_stat.slot));
+	fe_stat.slot_skips = 0;
 }
 
 bool check_nvme_stat() {
@@ -69,6 +75,7 @@ void send_nvme_cmd(struct nvme_request_entry *req) {
 		IO_WRITE32(addr + (idx * 4), nvme_io_cmd.dword[idx]);
 
 	IO_WRITE32(NVME_CMD_FIFO_REG_ADDR, nvme_cmd.dword);
+	req->submit_time = g_timer.current_time;
 
 	TASK_STATE_NEXT(req);
 }
@@ -86,52 +93,73 @@ void send_nvme_complete(struct nvme_request_entry *req) {
 }
 
 void set_task_complete(struct nvme_request_entry *task) {
-	TAILQ_REMOVE(&(fe_req_sq.head), task, entry);
+	stall_settle(task);
+	fe_stat.slot[task->cmd_id] = NULL;
 	fe_req_sq.outstanding--;
 	fe_stat.ongoing--;
 	send_nvme_complete(task);
 }
 
-void handle_dma_req(unsigned int cmd_id) {
+/* a descriptor covers sgBlockCnt contiguous 4KB blocks of the command */
+void handle_dma_req(unsigned int cmd_id, unsigned int direction, unsigned int tail) {
 	struct nvme_request_entry *req;
+	HOST_DMA_CMD_FIFO_REG dma_cmd;
+	unsigned int nblks, i;
 
-	TAILQ_FOREACH(req, &(fe_req_sq.head), entry) {
-		if (!ONGOING_TASK(req))
-			continue;
-		if (req->cmd_id == cmd_id) {
-			if (!--req->remaining_dma)
-				set_task_complete(req);
-			break;
-		}
-	}
-	
-	if (!req)
+	dma_cmd = g_hostDmaCmdQueue.cmd[tail][direction];
+	nblks = dma_cmd.sgBlockCnt ? dma_cmd.sgBlockCnt : 1;
+	g_dma_stats.descs++;
+	g_dma_stats.blks += nblks;
+
+	req = fe_stat.slot[cmd_id % FE_SLOTS];
+	if (!req) {
+		g_dma_stats.unknown++;
 		printf("No such req which cmd_id is %d\n", cmd_id);
+		return;
+	}
+
+	if (g_payload.enabled) {
+		for (i = 0; i < nblks; i++)
+			payload_host_dma(req, direction, dma_cmd.cmd4KBOffset + i, dma_cmd.devAddr + i * BYTES_PER_NVME_BLOCK);
+	}
+	req->remaining_dma -= nblks;
+	if (!req->remaining_dma)
+		set_task_complete(req);
 }
 
+/* next free slot in round-robin order, there is always one as long as the queue depth is at most FE_SLOTS */
 unsigned int get_cmd_id() {
-	unsigned int cmd_id = fe_stat.cmd_id;
-	fe_stat.cmd_id = ((cmd_id + 1) % (1 << P_SLOT_TAG_WIDTH));
+	unsigned int cmd_id = fe_stat.cmd_id, i;
+
+	for (i = 0; i < FE_SLOTS && fe_stat.slot[cmd_id]; i++) {
+		cmd_id = (cmd_id + 1) % FE_SLOTS;
+		fe_stat.slot_skips++;
+	}
+	assert(!fe_stat.slot[cmd_id] && "more commands in flight than cmd_id slots");
+	fe_stat.cmd_id = (cmd_id + 1) % FE_SLOTS;
 	return cmd_id;
 }
 
 void request_to_task(struct nvme_request_entry *req) {
 	req->cmd_id = get_cmd_id();
+	fe_stat.slot[req->cmd_id] = req;
 	req->state = req->op;
 	req->remaining_dma = req->nblks;
+	if (g_payload.enabled)
+		payload_submit(req);
 }
 
 void set_task_start_single() {
 	struct nvme_request_entry *req;
 
-	TAILQ_FOREACH(req, &(fe_req_sq.head), entry) {
-		if (!ONGOING_TASK(req)) {
-			request_to_task(req);
-			send_nvme_cmd(req);
-			fe_stat.ongoing++;
-			return;
-		}
-	}
+	req = TAILQ_FIRST(&(fe_req_sq.head));
+	if (!req)
+		return;
+
+	TAILQ_REMOVE(&(fe_req_sq.head), req, entry);
+	request_to_task(req);
+	send_nvme_cmd(req);
+	fe_stat.ongoing++;
 }
 
 void update_dma_status() {
@@ -158,13 +186,13 @@ int SchedulingFE() {
 	dma_fifo_tail.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR + 4);
 	while (fe_stat.last_rx_tail != dma_fifo_tail.autoDmaRx) {
 		cmd_id = recv_dma_cmd(HOST_DMA_RX_DIRECTION, fe_stat.last_rx_tail);
-		handle_dma_req(cmd_id);
+		handle_dma_req(cmd_id, HOST_DMA_RX_DIRECTION, fe_stat.last_rx_tail);
 		fe_stat.last_rx_tail++;
 		exe++;
 	}
 	while (fe_stat.last_tx_tail != dma_fifo_tail.autoDmaTx) {
 		cmd_id = recv_dma_cmd(HOST_DMA_TX_DIRECTION, fe_stat.last_tx_tail);
-		handle_dma_req(cmd_id);
+		handle_dma_req(cmd_id, HOST_DMA_TX_DIRECTION, fe_stat.last_tx_tail);
 		fe_stat.last_tx_tail++;
 		exe++;
 	}
@@ -172,3 +200,13 @@ int SchedulingFE() {
 
 	return exe;
 }
+
+void show_dma_stats() {
+	printf("==== Host DMA ====\n");
+	printf("Descriptors     : %llu (%llu 4KB blocks, %.2f per descriptor)\n", g_dma_stats.descs, g_dma_stats.blks,
+			g_dma_stats.descs ? (double)g_dma_stats.blks / g_dma_stats.descs : 0.0);
+	printf("FIFO pushes     : %llu saved over per-block DMA\n", g_dma_stats.blks - g_dma_stats.descs);
+	printf("Slot skips      : %llu (cmd_ids still held by a slow command)\n", fe_stat.slot_skips);
+	if (g_dma_stats.unknown)
+		printf("Unknown cmd_id  : %llu\n", g_dma_stats.unknown);
+}
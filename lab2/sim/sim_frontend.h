@@ -3,6 +3,8 @@
 
 #include <sys/queue.h>
 #include "nvme.h"
+#include "host_lld.h"
+#include "sim_stall.h"
 #include "stdbool.h"
 
 extern struct nvme_request_queue fe_req_sq;
@@ -20,11 +22,18 @@ struct nvme_request_entry {
 	unsigned int hid;
 	unsigned int op;
 	unsigned int cmd_id;
-	unsigned int request_time;
+	unsigned long long request_time;		// arrival
+	unsigned long long submit_time;			// written to the NVMe command FIFO
 	unsigned int state;
 	unsigned int blkaddr;
 	unsigned int nblks;
 	unsigned int remaining_dma;
+	unsigned int version;	// payload mode: data version stamped by this write
+	unsigned int stall[STALL_KINDS];				// us blocked per cause, see sim_stall.h
+	unsigned short stall_open[STALL_KINDS];			// FTL requests of this command held by the cause right now
+	unsigned int stall_frozen;						// outstanding when the FTL entered GarbageCollection()
+	unsigned long long stall_since[STALL_KINDS];
+	TAILQ_ENTRY(nvme_request_entry) stall_entry;	// in flight, from request_send() to stall_settle()
 	TAILQ_ENTRY(nvme_request_entry) entry;
 };
 
@@ -33,13 +42,30 @@ struct nvme_request_queue {
 	TAILQ_HEAD(nvme_request_queue_head, nvme_request_entry) head;
 };
 
+#define FE_SLOTS				(1 << P_SLOT_TAG_WIDTH)
+
+/*
+ * fe_req_sq only holds requests not sent yet, in submission order. Once a
+ * request gets its cmd_id it moves to slot[cmd_id] until its last DMA.
+ */
 struct fe_status {
 	unsigned int cmd_id;
 	unsigned int ongoing;
 	unsigned char last_rx_tail;
 	unsigned char last_tx_tail;
+	struct nvme_request_entry *slot[FE_SLOTS];
+	unsigned long long slot_skips;	// cmd_ids passed over, still held by a slow command
+};
+
+/* host DMA descriptors the frontend handled, one per FIFO entry */
+struct dma_stats {
+	unsigned long long descs;
+	unsigned long long blks;
+	unsigned long long unknown;		// descriptors naming no ongoing command
 };
 
+extern struct dma_stats g_dma_stats;
+
 void init_fe();
 void init_fe_req_queues();
 void init_fe_stat();
@@ -51,8 +77,9 @@ void send_nvme_cmd(struct nvme_request_entry *req);
 void send_nvme_complete(struct nvme_request_entry *req);
 void set_task_start_single();
 void set_task_complete(struct nvme_request_entry *task);
-void handle_dma_req(unsigned int cmd_id);
+void handle_dma_req(unsigned int cmd_id, unsigned int direction, unsigned int tail);
 void update_dma_status();
 int SchedulingFE();
+void show_dma_stats();
 
 #endif /* SIM_FRONTEND_H_ */
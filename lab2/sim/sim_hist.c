@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_hist.h"
+
+struct hist_writer g_hist;
+
+static const char *hist_names[HIST_STREAMS] = {"lat", "perf"};
+
+int hist_parse_format(const char *name) {
+	if (!strcmp(name, "csv"))
+		return HIST_FORMAT_CSV;
+	if (!strcmp(name, "bin"))
+		return HIST_FORMAT_BIN;
+	return -1;
+}
+
+static unsigned int hist_put_varint(unsigned char *out, unsigned long long v) {
+	unsigned int n = 0;
+
+	while (v >= 0x80) {
+		out[n++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	out[n++] = (unsigned char)v;
+	return n;
+}
+
+static int hist_get_varint(FILE *fp, unsigned long long *v) {
+	unsigned int shift = 0;
+	int c;
+
+	*v = 0;
+	while ((c = getc(fp)) != EOF) {
+		*v |= (unsigned long long)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return 1;
+		shift += 7;
+		if (shift > 63)
+			return -1;
+	}
+	return shift ? -1 : 0;
+}
+
+unsigned int hist_encode(unsigned char *out, const unsigned long long *rec, unsigned int fields, unsigned long long *last_time) {
+	long long delta = (long long)(rec[0] - *last_time);
+	unsigned int n, i;
+
+	n = hist_put_varint(out, ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63));
+	for (i = 1; i < fields; i++)
+		n += hist_put_varint(out + n, rec[i]);
+	*last_time = rec[0];
+	return n;
+}
+
+/* 1 for a record, 0 at the end of the file, -1 for a truncated record */
+int hist_decode(FILE *fp, unsigned long long *rec, unsigned int fields, unsigned long long *last_time) {
+	unsigned long long zz;
+	unsigned int i;
+	int ret;
+
+	ret = hist_get_varint(fp, &zz);
+	if (ret <= 0)
+		return ret;
+	rec[0] = *last_time + (unsigned long long)((long long)(zz >> 1) ^ -(long long)(zz & 1));
+	for (i = 1; i < fields; i++)
+		if (hist_get_varint(fp, &rec[i]) != 1)
+			return -1;
+	*last_time = rec[0];
+	return 1;
+}
+
+static void hist_write_chunk(struct hist_stream *s, struct hist_chunk *c) {
+	static unsigned char buf[HIST_ENCODE_BUF];
+	unsigned long long *rec;
+	unsigned int i, f, len = 0;
+
+	if (g_hist.format == HIST_FORMAT_CSV && s->fields == HIST_FIELDS) {
+		for (i = 0; i < c->n; i++) {
+			rec = c->rec + (size_t)i * s->fields;
+			s->bytes += fprintf(s->fp, "%llu,%llu,%llu,%llu,%llu,%llu\n", rec[0], rec[1], rec[2], rec[3], rec[4], rec[5]);
+		}
+	} else if (g_hist.format == HIST_FORMAT_CSV) {
+		for (i = 0; i < c->n; i++) {
+			rec = c->rec + (size_t)i * s->fields;
+			for (f = 0; f < s->fields; f++)
+				s->bytes += fprintf(s->fp, f ? ",%llu" : "%llu", rec[f]);
+			s->bytes += fprintf(s->fp, "\n");
+		}
+	} else {
+		for (i = 0; i < c->n; i++) {
+			if (len + HIST_RECORD_MAX > sizeof(buf)) {
+				fwrite(buf, 1, len, s->fp);
+				s->bytes += len;
+				len = 0;
+			}
+			len += hist_encode(buf + len, c->rec + (size_t)i * s->fields, s->fields, &s->last_time);
+		}
+		fwrite(buf, 1, len, s->fp);
+		s->bytes += len;
+	}
+	s->records += c->n;
+}
+
+/* the only thread touching the files, chunks of a stream are written in the order they filled */
+static void *hist_writer_main(void *arg) {
+	struct hist_stream *s;
+	unsigned int idx, b;
+	int found;
+
+	pthread_mutex_lock(&g_hist.lock);
+	while (1) {
+		found = 0;
+		for (idx = 0; idx < HIST_STREAMS; idx++) {
+			s = &g_hist.stream[idx];
+			b = s->next;
+			if (!s->full[b])
+				continue;
+
+			pthread_mutex_unlock(&g_hist.lock);
+			hist_write_chunk(s, s->chunk[b]);
+			pthread_mutex_lock(&g_hist.lock);
+
+			s->full[b] = 0;
+			s->next ^= 1;
+			pthread_cond_broadcast(&g_hist.done);
+			found = 1;
+		}
+		if (found)
+			continue;
+		if (g_hist.stop)
+			break;
+		pthread_cond_wait(&g_hist.work, &g_hist.lock);
+	}
+	pthread_mutex_unlock(&g_hist.lock);
+
+	return NULL;
+}
+
+void init_hist_writer(const char *output_dir, int format, unsigned int lat_fields) {
+	struct hist_file_header header;
+	struct hist_stream *s;
+	char path[512];
+	unsigned int idx;
+
+	memset(&g_hist, 0, sizeof(g_hist));
+	g_hist.format = format;
+
+	for (idx = 0; idx < HIST_STREAMS; idx++) {
+		s = &g_hist.stream[idx];
+		s->fields = idx == HIST_LAT ? lat_fields : HIST_FIELDS;
+		snprintf(path, sizeof(path), "%s/%s.%s", output_dir ? output_dir : ".", hist_names[idx], format == HIST_FORMAT_CSV ? "csv" : "bin");
+		s->fp = fopen(path, "w");
+		if (!s->fp) {
+			fprintf(stderr, "Failed to open %s.\n", path);
+			exit(1);
+		}
+		s->chunk[0] = (struct hist_chunk *)malloc(sizeof(struct hist_chunk) + sizeof(unsigned long long) * HIST_CHUNK_RECS * s->fields);
+		s->chunk[1] = (struct hist_chunk *)malloc(sizeof(struct hist_chunk) + sizeof(unsigned long long) * HIST_CHUNK_RECS * s->fields);
+		if (!s->chunk[0] || !s->chunk[1]) {
+			fprintf(stderr, "Failed to allocate history buffers.\n");
+			exit(1);
+		}
+		s->chunk[0]->n = 0;
+		s->chunk[1]->n = 0;
+
+		if (format == HIST_FORMAT_BIN) {
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic, HIST_MAGIC, sizeof(header.magic));
+			header.version = HIST_VERSION;
+			header.stream = idx;
+			header.fields = s->fields;
+			fwrite(&header, sizeof(header), 1, s->fp);
+		}
+	}
+
+	pthread_mutex_init(&g_hist.lock, NULL);
+	pthread_cond_init(&g_hist.work, NULL);
+	pthread_cond_init(&g_hist.done, NULL);
+	if (pthread_create(&g_hist.thread, NULL, hist_writer_main, NULL)) {
+		fprintf(stderr, "Failed to start history writer.\n");
+		exit(1);
+	}
+	g_hist.enabled = 1;
+}
+
+/* hand the current chunk to the writer and switch to the other one, waiting only if it is still being written */
+void hist_submit(unsigned int idx) {
+	struct hist_stream *s = &g_hist.stream[idx];
+
+	pthread_mutex_lock(&g_hist.lock);
+	s->full[s->cur] = 1;
+	pthread_cond_signal(&g_hist.work);
+	s->cur ^= 1;
+	if (s->full[s->cur])
+		g_hist.stalls++;
+	while (s->full[s->cur])
+		pthread_cond_wait(&g_hist.done, &g_hist.lock);
+	pthread_mutex_unlock(&g_hist.lock);
+
+	s->chunk[s->cur]->n = 0;
+}
+
+void stop_hist_writer() {
+	struct hist_stream *s;
+	unsigned int idx;
+
+	if (!g_hist.enabled)
+		return;
+
+	for (idx = 0; idx < HIST_STREAMS; idx++)
+		if (g_hist.stream[idx].chunk[g_hist.stream[idx].cur]->n)
+			hist_submit(idx);
+
+	pthread_mutex_lock(&g_hist.lock);
+	g_hist.stop = 1;
+	pthread_cond_signal(&g_hist.work);
+	pthread_mutex_unlock(&g_hist.lock);
+	pthread_join(g_hist.thread, NULL);
+
+	printf("==== History Writer ====\n");
+	for (idx = 0; idx < HIST_STREAMS; idx++) {
+		s = &g_hist.stream[idx];
+		printf("%-16s: %llu records, %llu KB %s\n", hist_names[idx], s->records, s->bytes >> 10,
+				g_hist.format == HIST_FORMAT_CSV ? "csv" : "bin");
+		fclose(s->fp);
+		free(s->chunk[0]);
+		free(s->chunk[1]);
+	}
+	printf("Writer stalls   : %llu (main thread waited for a buffer)\n", g_hist.stalls);
+
+	g_hist.enabled = 0;
+}
@@ -0,0 +1,109 @@
+#ifndef SIM_HIST_H_
+#define SIM_HIST_H_
+
+#include <stdio.h>
+#include <pthread.h>
+
+#define HIST_LAT					0	// lat: time hid op lat lba nblks [gc erase bufdep rowdep]
+#define HIST_PERF					1	// perf: time hid rb wb ri wi
+#define HIST_STREAMS				2
+#define HIST_FIELDS					6
+#define HIST_FIELDS_MAX				10	// lat with the stall breakdown (-B)
+#define HIST_CHUNK_RECS				(1 << 15)	// records per buffer, two buffers per stream
+#define HIST_ENCODE_BUF				(1 << 16)	// bin: encoded bytes written at once
+
+#define HIST_FORMAT_CSV				0
+#define HIST_FORMAT_BIN				1
+
+#define HIST_MAGIC					"COSMHIST"
+#define HIST_VERSION				1
+#define HIST_RECORD_MAX				(HIST_FIELDS_MAX * 10)	// varint bytes of one record, worst case
+
+/*
+ * Binary history file: this header, then one record per line of the CSV.
+ * A record is "fields" LEB128 varints, the time field holds the
+ * zigzag-encoded difference to the previous record's time.
+ */
+struct hist_file_header {
+	char magic[8];
+	unsigned int version;
+	unsigned int stream;
+	unsigned int fields;
+	unsigned int reserved;
+};
+
+/* HIST_CHUNK_RECS records of the stream's field count each */
+struct hist_chunk {
+	unsigned int n;
+	unsigned long long rec[];
+};
+
+struct hist_stream {
+	FILE *fp;
+	unsigned int fields;			// written per record, the rest of rec[] is ignored
+	struct hist_chunk *chunk[2];
+	unsigned int cur;				// filled by the main thread
+	unsigned int next;				// next one the writer takes, chunks go out in order
+	int full[2];					// handed to the writer
+	unsigned long long last_time;	// writer only, base of the time delta
+	unsigned long long records;
+	unsigned long long bytes;
+};
+
+struct hist_writer {
+	int enabled;
+	int format;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t work;			// main -> writer: chunk full or stop
+	pthread_cond_t done;			// writer -> main: chunk written
+	int stop;
+	unsigned long long stalls;		// main thread waited for a free chunk
+	struct hist_stream stream[HIST_STREAMS];
+};
+
+extern struct hist_writer g_hist;
+
+int hist_parse_format(const char *name);
+void init_hist_writer(const char *output_dir, int format, unsigned int lat_fields);
+void hist_submit(unsigned int idx);
+void stop_hist_writer();
+unsigned int hist_encode(unsigned char *out, const unsigned long long *rec, unsigned int fields, unsigned long long *last_time);
+int hist_decode(FILE *fp, unsigned long long *rec, unsigned int fields, unsigned long long *last_time);
+
+/* next record to fill, NULL when not reporting; hist_commit() hands it over */
+static inline unsigned long long *hist_reserve(unsigned int idx) {
+	struct hist_stream *s = &g_hist.stream[idx];
+	struct hist_chunk *c;
+
+	if (!g_hist.enabled)
+		return NULL;
+
+	c = s->chunk[s->cur];
+	return c->rec + (size_t)c->n * s->fields;
+}
+
+static inline void hist_commit(unsigned int idx) {
+	struct hist_stream *s = &g_hist.stream[idx];
+
+	if (++s->chunk[s->cur]->n == HIST_CHUNK_RECS)
+		hist_submit(idx);
+}
+
+static inline void hist_append(unsigned int idx, unsigned long long v0, unsigned long long v1, unsigned long long v2,
+		unsigned long long v3, unsigned long long v4, unsigned long long v5) {
+	unsigned long long *rec = hist_reserve(idx);
+
+	if (!rec)
+		return;
+
+	rec[0] = v0;
+	rec[1] = v1;
+	rec[2] = v2;
+	rec[3] = v3;
+	rec[4] = v4;
+	rec[5] = v5;
+	hist_commit(idx);
+}
+
+#endif /* SIM_HIST_H_ */
@@ -3,13 +3,20 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <math.h>
 
 #include "host_lld.h"
+#include "request_allocation.h"
+#include "garbage_collection.h"
 
 #include "sim_main.h"
 #include "sim_host.h"
 #include "sim_frontend.h"
 #include "sim_backend.h"
+#include "sim_payload.h"
+#include "sim_hist.h"
+#include "sim_stall.h"
 /* === GC live totals for console & CSV === */
 #include <inttypes.h>
 extern uint64_t g_ts_gc_victim_selects;   // total GC count
@@ -26,6 +33,30 @@ void init_host_config(struct host_config *config, unsigned int *opt) {
 	config->op_read_pcent = opt[1];
 	config->op_write_pcent = opt[2];
 	config->nblks = opt[3];
+	config->sizes.n = 1;
+	config->sizes.range = 0;
+	config->sizes.nblks[0] = opt[3];
+	config->sizes.weight[0] = 1;
+	config->param[0] = pattern_defaults[config->pattern % PATTERNS][0];
+	config->param[1] = pattern_defaults[config->pattern % PATTERNS][1];
+}
+
+/* what a turn of the host is worth, see ADMIT_* */
+static int sched_quantum(struct host *host) {
+	int weight = host->config.weight ? host->config.weight : 1;
+
+	if (sim.config.sched == ADMIT_DRR)
+		return weight * HOST_MAX_NBLKS;
+	if (sim.config.sched == ADMIT_WRR)
+		return weight;
+	return 1;
+}
+
+/* outstanding changes by delta, the time it held the old value goes to the mean queue depth */
+static void host_qd_update(struct host *host, int delta) {
+	host->qd_sum += (unsigned long long)host->outstanding * (g_timer.current_time - host->qd_since);
+	host->qd_since = g_timer.current_time;
+	host->outstanding += delta;
 }
 
 void init_hosts() {
@@ -40,22 +71,39 @@ void init_hosts() {
 		host->complete_blks[1] = 0;
 		host->last_complete_blks[0] = 0;
 		host->last_complete_blks[1] = 0;
-
-		host->next_blkaddr = get_next_blkaddr(host);
+		rng_seed(&host->rng, sim.config.seed, host->hid);
+		rng_seed(&host->arrival_rng, sim.config.seed, host->hid + (1ULL << 32));
+		host->arrival_base = g_timer.current_time;
+		host->arrival_clock = 0;
+		host->arrival = g_timer.current_time;
+		host->outstanding = 0;
+		host->credit = i ? 0 : sched_quantum(host);
+		host->issued[0] = 0;
+		host->issued[1] = 0;
+		host->qd_sum = 0;
+		host->qd_since = g_timer.current_time;
+		host->qd_start = g_timer.current_time;
+		dist_init(&host->dist, host->config.pattern, (host->config.max_lba - host->config.min_lba) / 4, host->config.param);
+
+		host->next_blkaddr = get_next_blkaddr(host, host->config.nblks);
 	}
 }
 
-unsigned int get_next_blkaddr(struct host *host) {
-	struct host_config config = host->config;
+/* address of a command of nblks, a sequential stream continues after it */
+unsigned int get_next_blkaddr(struct host *host, unsigned int nblks) {
+	struct host_config *config = &host->config;
 	unsigned int blkaddr = host->next_blkaddr;
 
-	if (config.pattern)
-		host->next_blkaddr = (config.min_lba + (rand() % (config.max_lba - config.min_lba))) / 4 * 4;
-		//host->next_blkaddr = config.min_lba + (rand() % (config.max_lba - config.min_lba));
+	if (config->pattern >= PATTERN_ZIPF)
+		host->next_blkaddr = (config->min_lba + dist_next(&host->dist, &host->rng) * 4) / 4 * 4;
+	else if (config->pattern)
+		host->next_blkaddr = (config->min_lba + rng_below(&host->rng, config->max_lba - config->min_lba)) / 4 * 4;
+		//host->next_blkaddr = config->min_lba + (rand() % (config->max_lba - config->min_lba));
 	else
-		host->next_blkaddr = ((blkaddr + config.nblks - config.min_lba) % (config.max_lba - config.min_lba)) + config.min_lba;
+		host->next_blkaddr = ((blkaddr + nblks - config->min_lba) % (config->max_lba - config->min_lba)) + config->min_lba;
 
-	if (blkaddr % 4)
+	/* mixed sizes move a sequential stream off the slice grid on purpose */
+	if (blkaddr % 4 && config->sizes.n == 1 && !config->sizes.range)
 		printf("UNALIGNED BLKADDR: %d\n", blkaddr);
 
 	return blkaddr;
@@ -67,17 +115,22 @@ struct nvme_request_entry *create_request(struct job job) {
 	req->hid = job.hid;
 	req->op = job.op;
 	req->cmd_id = CMD_NONE;
-	req->request_time = g_timer.current_time;
+	req->request_time = job.time;
 	req->blkaddr = job.blkaddr;
 	req->nblks = job.nblks;
 	req->state = 0;
 	req->remaining_dma = 0;
+	req->version = 0;
+	memset(req->stall, 0, sizeof(req->stall));
+	memset(req->stall_open, 0, sizeof(req->stall_open));
+	req->stall_frozen = 0;
 
 	return req;
 }
 
 void request_send(struct nvme_request_entry *req) {
 	TAILQ_INSERT_TAIL(&(fe_req_sq.head), req, entry);
+	stall_submit(req);
 }
 
 struct nvme_request_entry *request_recv() {
@@ -95,7 +148,8 @@ void update_and_print_bw() {
 	unsigned long long ctime = g_timer.current_time;
 	float rb, wb, ri, wi;
 	struct host *host;
-	int hid;
+	char wl[256], rl[256];
+	int hid, op;
 
 	for (hid = 0; hid < sim.config.nhosts; hid++) {
 		host = &(sim.hosts[hid]);
@@ -110,18 +164,20 @@ void update_and_print_bw() {
 		host->last_complete_blks[0] = host->complete_blks[0];
 		host->last_complete_blks[1] = host->complete_blks[1];
 
-		sim.hist[1][sim.hist_idx[1]][0] = ctime - sim.initial_report_time;
-		sim.hist[1][sim.hist_idx[1]][1] = hid;
-		sim.hist[1][sim.hist_idx[1]][2] = (unsigned int)rb;
-		sim.hist[1][sim.hist_idx[1]][3] = (unsigned int)wb;
-		sim.hist[1][sim.hist_idx[1]][4] = (unsigned int)ri;
-		sim.hist[1][sim.hist_idx[1]++][5] = (unsigned int)wi;
-		if (sim.hist_idx[1] == HIST_BUF_MAX) {
-			flush_hist_to_file(1);
-			sim.hist_idx[1] = 0;
-		}
+		hist_append(HIST_PERF, ctime - sim.initial_report_time, hid, (unsigned int)rb, (unsigned int)wb, (unsigned int)ri, (unsigned int)wi);
 
 		printf("[%llus]Host[%d]: Current BW[R %.2fMB/s, W %.2fMB/s] IOPS[R %.2f KIOPS, W %.2f KIOPS] GC[%u] Copies[%u]\n", (ctime - sim.initial_report_time)/1000000, hid, rb, wb, ri, wi, (unsigned)g_ts_gc_victim_selects, (unsigned)g_ts_gc_valid_copied_sum);
+
+		if (host->lat[0].count || host->lat[1].count) {
+			lat_hist_format(&host->lat[0], wl, sizeof(wl));
+			lat_hist_format(&host->lat[1], rl, sizeof(rl));
+			printf("[%llus]Host[%d]: Lat(us) R[%s] W[%s]\n", (ctime - sim.initial_report_time)/1000000, hid,
+					host->lat[1].count ? rl : "-", host->lat[0].count ? wl : "-");
+		}
+		for (op = 0; op < 2; op++) {
+			lat_hist_merge(&host->lat_total[op], &host->lat[op]);
+			lat_hist_reset(&host->lat[op]);
+		}
 }
 	sim.last_report_time = ctime;
 }
@@ -129,6 +185,8 @@ void update_and_print_bw() {
 void perf_report(struct nvme_request_entry *req) {
 	unsigned long long ctime = g_timer.current_time;
 	int lat = (int)(ctime - req->request_time + 1);
+	unsigned long long *rec;
+	unsigned int kind;
 
 	if (!sim.initial_report_time) {
 		sim.initial_report_time = ctime;
@@ -137,25 +195,168 @@ void perf_report(struct nvme_request_entry *req) {
 
 	sim.hosts[req->hid].complete_blks[req->op - 1] += req->nblks;
 	sim.hosts[req->hid].complete_reqs[req->op - 1]++;
-	sim.hist[0][sim.hist_idx[0]][0] = ctime - sim.initial_report_time;
-	sim.hist[0][sim.hist_idx[0]][1] = req->hid;
-	sim.hist[0][sim.hist_idx[0]][2] = req->op;
-	sim.hist[0][sim.hist_idx[0]][3] = lat;
-	sim.hist[0][sim.hist_idx[0]][4] = req->blkaddr;
-	sim.hist[0][sim.hist_idx[0]++][5] = req->nblks;
-	if (sim.hist_idx[0] == HIST_BUF_MAX) {
-		flush_hist_to_file(0);
-		sim.hist_idx[0] = 0;
+	lat_hist_record(&sim.hosts[req->hid].lat[req->op - 1], lat);
+	lat_hist_record(&sim.hosts[req->hid].wait_total[req->op - 1], req->submit_time - req->request_time);
+	lat_hist_record(&sim.hosts[req->hid].svc_total[req->op - 1], ctime - req->submit_time);
+	stall_report(req, lat);
+
+	rec = hist_reserve(HIST_LAT);
+	if (rec) {
+		rec[0] = ctime - sim.initial_report_time;
+		rec[1] = req->hid;
+		rec[2] = req->op;
+		rec[3] = lat;
+		rec[4] = req->blkaddr;
+		rec[5] = req->nblks;
+		if (sim.config.breakdown)
+			for (kind = 0; kind < STALL_KINDS; kind++)
+				rec[HIST_FIELDS + kind] = req->stall[kind];
+		hist_commit(HIST_LAT);
 	}
 
 	if (ctime > sim.last_report_time + 1000000) 
 		update_and_print_bw();
 }
 
+/* whole-run tail latency, samples after the last report are folded in first */
+void show_lat_stats() {
+	static const char *op_names[2] = {"W", "R"};
+	struct host *host;
+	char buf[256];
+	int hid, op;
+
+	printf("==== Latency Percentiles (us) ====\n");
+	for (hid = 0; hid < sim.config.nhosts; hid++) {
+		host = &(sim.hosts[hid]);
+		for (op = 0; op < 2; op++) {
+			lat_hist_merge(&host->lat_total[op], &host->lat[op]);
+			lat_hist_reset(&host->lat[op]);
+			if (!host->lat_total[op].count)
+				continue;
+			lat_hist_format(&host->lat_total[op], buf, sizeof(buf));
+			printf("Host[%d] %s: %llu ops, mean %.1f, %s\n", hid, op_names[op], host->lat_total[op].count,
+					(double)host->lat_total[op].sum / host->lat_total[op].count, buf);
+			if (!host_open_loop(host))
+				continue;
+			/* open loop latency is queueing plus service, the knee shows in the first */
+			lat_hist_format(&host->wait_total[op], buf, sizeof(buf));
+			printf("  queue   : mean %.1f, %s\n", (double)host->wait_total[op].sum / host->wait_total[op].count, buf);
+			lat_hist_format(&host->svc_total[op], buf, sizeof(buf));
+			printf("  service : mean %.1f, %s\n", (double)host->svc_total[op].sum / host->svc_total[op].count, buf);
+		}
+	}
+}
+
+void init_traces() {
+	struct host *host;
+	int i;
+
+	if (sim.config.ntraces > sim.config.nhosts) {
+		fprintf(stderr, "%d traces for %d workers.\n", sim.config.ntraces, sim.config.nhosts);
+		exit(1);
+	}
+	for (i = 0; i < sim.config.nhosts; i++) {
+		host = &(sim.hosts[i]);
+		host->trace = NULL;
+		host->trace_nblks = 0;
+		host->trace_cmds = 0;
+		host->trace_late = 0;
+		host->trace_wait = 0;
+		if (i >= sim.config.ntraces)
+			continue;
+		if (host->config.arrival != ARRIVAL_CLOSED) {
+			fprintf(stderr, "Worker[%d] replays a trace, -m sets its arrivals.\n", i);
+			exit(1);
+		}
+		host->trace = (struct trace *)malloc(sizeof(struct trace));
+		trace_open(host->trace, sim.config.trace[i]);
+	}
+}
+
+void show_trace_stats() {
+	struct host *host;
+	int hid;
+
+	if (!sim.config.ntraces)
+		return;
+	printf("==== Trace Replay ====\n");
+	for (hid = 0; hid < sim.config.ntraces; hid++) {
+		host = &(sim.hosts[hid]);
+		printf("Worker[%d]       : %s (%s)\n", hid, host->trace->path, trace_format_names[host->trace->format]);
+		printf("Records         : %llu read, %llu lines skipped, %llu commands\n", host->trace->records, host->trace->skipped, host->trace_cmds);
+		if (sim.config.replay == REPLAY_OPEN)
+			printf("Late arrivals   : %llu (mean %.1f us behind, queue depth %u)\n", host->trace_late,
+					host->trace_late ? (double)host->trace_wait / host->trace_late : 0.0, sim.config.qd);
+		trace_close(host->trace);
+		free(host->trace);
+		host->trace = NULL;
+	}
+}
+
+/* admission share of each worker, only when -Q or -W changed it from plain round robin */
+void show_worker_stats() {
+	static const char *admit_names[ADMITS] = {"rr", "wrr", "drr"};
+	unsigned long long cmds = 0, blks = 0, elapsed;
+	double share, sum = 0, sq = 0;
+	struct host *host;
+	int hid;
+
+	if (!sim.config.nqds && sim.config.sched == ADMIT_RR)
+		return;
+	for (hid = 0; hid < sim.config.nhosts; hid++) {
+		cmds += sim.hosts[hid].issued[0];
+		blks += sim.hosts[hid].issued[1];
+	}
+	printf("==== Worker Admission (%s) ====\n", admit_names[sim.config.sched]);
+	for (hid = 0; hid < sim.config.nhosts; hid++) {
+		host = &(sim.hosts[hid]);
+		host_qd_update(host, 0);
+		elapsed = g_timer.current_time - host->qd_start;
+		printf("Worker[%d]       : qd %u weight %u, %llu cmds (%.1f%%), %llu blks (%.1f%%), mean qd %.2f\n", hid,
+				host->config.qd ? host->config.qd : sim.config.qd, host->config.weight ? host->config.weight : 1,
+				host->issued[0], cmds ? 100.0 * host->issued[0] / cmds : 0.0,
+				host->issued[1], blks ? 100.0 * host->issued[1] / blks : 0.0,
+				elapsed ? (double)host->qd_sum / elapsed : 0.0);
+		/* blocks per unit of weight, equal for every worker when admission is fair */
+		share = (double)host->issued[1] / (host->config.weight ? host->config.weight : 1);
+		sum += share;
+		sq += share * share;
+	}
+	printf("Fairness        : %.3f (Jain, blocks per weight)\n", sq ? sum * sum / (sim.config.nhosts * sq) : 1.0);
+}
+
 bool check_remaining_jobs() {
 	return (sim.remaining_jobs || fe_req_sq.outstanding || fe_req_cq.outstanding);
 }
 
+unsigned int select_nblks(struct host *host) {
+	struct size_dist *sizes = &host->config.sizes;
+	unsigned int w, i;
+
+	if (sizes->range)
+		return sizes->nblks[0] + rng_below(&host->rng, sizes->nblks[1] - sizes->nblks[0] + 1);
+	if (sizes->n == 1)
+		return sizes->nblks[0];
+	w = rng_below(&host->rng, sizes->weight[sizes->n - 1]);
+	for (i = 0; w >= sizes->weight[i]; i++)
+		;
+	return sizes->nblks[i];
+}
+
+/* "4", "1~256" or "1:70,16:20,64:10", in 4KB blocks */
+int format_size_dist(const struct size_dist *sizes, char *buf, unsigned int len) {
+	unsigned int i;
+	int n = 0;
+
+	if (sizes->range)
+		return snprintf(buf, len, "%u~%u", sizes->nblks[0], sizes->nblks[1]);
+	if (sizes->n == 1)
+		return snprintf(buf, len, "%u", sizes->nblks[0]);
+	for (i = 0; i < sizes->n; i++)
+		n += snprintf(buf + n, len - n, "%s%u:%u", i ? "," : "", sizes->nblks[i], sizes->weight[i] - (i ? sizes->weight[i - 1] : 0));
+	return n;
+}
+
 unsigned int select_op(struct host *host) {
 	host->acc += host->config.op_read_pcent;
 	if (host->acc >= 100) {
@@ -165,26 +366,173 @@ unsigned int select_op(struct host *host) {
 		return IO_NVM_WRITE;
 }
 
-struct job get_next_job() {
-	struct host *host = &(sim.hosts[sim.next_hid]);
+/* pending trace request of the host, 0 once the trace ended */
+static int trace_fill(struct host *host) {
+	struct trace_record rec;
+
+	if (host->trace_nblks)
+		return 1;
+	if (!host->trace->map || !trace_next(host->trace, &rec)) {
+		trace_close(host->trace);
+		return 0;
+	}
+	if (host->trace->records == 1) {
+		host->trace_start = rec.time;
+		host->trace_base = g_timer.current_time;
+	}
+	/* out of order timestamps are issued right away */
+	host->trace_time = rec.time > host->trace_start ? rec.time - host->trace_start : 0;
+	host->arrival = host->trace_base + host->trace_time;
+	host->trace_blk = rec.sector / (4096 / TRACE_SECTOR_SIZE);
+	host->trace_nblks = (rec.sector + rec.nsectors + 4096 / TRACE_SECTOR_SIZE - 1) / (4096 / TRACE_SECTOR_SIZE) - host->trace_blk;
+	host->trace_op = rec.op;
+	return 1;
+}
+
+int host_open_loop(struct host *host) {
+	if (host->trace)
+		return sim.config.replay == REPLAY_OPEN;
+	return host->config.arrival != ARRIVAL_CLOSED;
+}
+
+/* arrival of the command after the one just issued */
+static void arrival_next(struct host *host) {
+	struct host_config *config = &host->config;
+	unsigned long long t;
+	double gap = 1000000 / config->iops;
+
+	if (config->arrival != ARRIVAL_CONST)
+		gap *= -log(1 - rng_double(&host->arrival_rng));
+	host->arrival_clock += gap;
+	t = host->arrival_clock;
+	if (config->arrival == ARRIVAL_ONOFF)
+		t = t / config->on_us * (config->on_us + config->off_us) + t % config->on_us;
+	host->arrival = host->arrival_base + t;
+}
+
+static int host_capped(struct host *host) {
+	return host->config.qd && host->outstanding >= host->config.qd;
+}
+
+static int host_ready(struct host *host) {
+	if (host_capped(host))
+		return 0;
+	if (host->trace && !trace_fill(host))
+		return 0;
+	return !host_open_loop(host) || host->arrival <= g_timer.current_time;
+}
+
+/*
+ * Next host with a command to issue; NULL if every host waits for its next
+ * arrival or a free slot under its queue depth. The host at next_hid keeps
+ * the turn while it has credit, a host with nothing to issue gives it up
+ * and, under ADMIT_DRR, its deficit with it.
+ */
+struct host *get_next_host() {
+	struct host *host;
+	int i, alive = 0;
+
+	for (i = 0; i <= sim.config.nhosts; i++) {
+		host = &(sim.hosts[sim.next_hid]);
+		if (host->credit > 0) {
+			if (host_ready(host))
+				return host;
+			if (sim.config.sched == ADMIT_DRR && !host_capped(host))
+				host->credit = 0;
+		}
+		/* the host the scan started at is looked at again as the last one */
+		if (i && (!host->trace || host->trace->map))
+			alive++;
+		sim.next_hid = (sim.next_hid + 1) % sim.config.nhosts;
+		host = &(sim.hosts[sim.next_hid]);
+		if (sim.config.sched == ADMIT_DRR)
+			host->credit += sched_quantum(host);
+		else
+			host->credit = sched_quantum(host);
+	}
+	if (!alive)
+		sim.remaining_jobs = 0;
+	return NULL;
+}
+
+struct job get_next_job(struct host *host) {
+	struct host_config *config = &host->config;
+	unsigned long long part_end;
 	struct job job;
 
 	job.hid = host->hid;
-	job.op = select_op(host);
-	job.blkaddr = get_next_blkaddr(host);
-	job.nblks = host->config.nblks;
+	job.time = host_open_loop(host) ? host->arrival : g_timer.current_time;
+	if (!host->trace) {
+		job.op = select_op(host);
+		job.nblks = select_nblks(host);
+		job.blkaddr = get_next_blkaddr(host, job.nblks);
+		if (config->arrival != ARRIVAL_CLOSED)
+			arrival_next(host);
+		return job;
+	}
 
-	sim.next_hid = (sim.next_hid + 1) % (sim.config.nhosts);
+	/* the trace's address space is folded into the worker's partition */
+	part_end = config->max_lba + config->nblks;
+	job.op = host->trace_op;
+	job.nblks = host->trace_nblks < HOST_MAX_NBLKS ? host->trace_nblks : HOST_MAX_NBLKS;
+	if (job.nblks > part_end - config->min_lba)
+		job.nblks = part_end - config->min_lba;
+	job.blkaddr = config->min_lba + host->trace_blk % (part_end - config->min_lba);
+	if (job.blkaddr + job.nblks > part_end)
+		job.blkaddr = part_end - job.nblks;
+
+	if (sim.config.replay == REPLAY_OPEN && g_timer.current_time > host->arrival) {
+		host->trace_late++;
+		host->trace_wait += g_timer.current_time - host->arrival;
+	}
+	host->trace_blk += job.nblks;
+	host->trace_nblks -= job.nblks;
+	host->trace_cmds++;
 
 	return job;
 }
 
+/* earliest arrival an open loop host waits for, 0 if none */
+static unsigned long long host_wake_time() {
+	unsigned long long wake = 0;
+	struct host *host;
+	int hid;
+
+	if (!sim.remaining_jobs || (!sim.config.narrivals && !(sim.config.ntraces && sim.config.replay == REPLAY_OPEN)))
+		return 0;
+	for (hid = 0; hid < sim.config.nhosts; hid++) {
+		host = &(sim.hosts[hid]);
+		if (!host_open_loop(host) || (host->trace && !host->trace_nblks))
+			continue;
+		if (host->arrival > g_timer.current_time && (!wake || host->arrival < wake))
+			wake = host->arrival;
+	}
+	return wake;
+}
+
 int SchedulingHost() {
 	int exe = 0;
 	struct nvme_request_entry *req;
+	struct host *host;
+
+	/* nothing in flight, move the clock to the next arrival; an idle gap is where background GC runs */
+	if (g_timer.wake_time > g_timer.current_time && !fe_req_sq.outstanding && !fe_req_cq.outstanding &&
+			nvmeDmaReqQ.headReq == REQ_SLOT_TAG_NONE && !notCompletedNandReqCnt && !blockedReqCnt && !BackgroundGcPending()) {
+		if (TIMER_EMPTY())
+			g_timer.current_time = g_timer.wake_time;
+		else
+			timer_warp();
+	}
 
-	while (sim.remaining_jobs && fe_req_sq.outstanding < MAX_QUEUE_DEPTH) {
-		struct job job = get_next_job();
+	while (sim.remaining_jobs && fe_req_sq.outstanding < sim.config.qd) {
+		host = get_next_host();
+		if (!host)
+			break;
+		struct job job = get_next_job(host);
+		host->credit -= sim.config.sched == ADMIT_DRR ? (int)job.nblks : 1;
+		host->issued[0]++;
+		host->issued[1] += job.nblks;
+		host_qd_update(host, 1);
 		req = create_request(job);
 		request_send(req);
 		fe_req_sq.outstanding++;
@@ -194,11 +542,15 @@ int SchedulingHost() {
 
 	while (fe_req_cq.outstanding) {
 		req = request_recv();
+		if (g_payload.enabled && req->op == IO_NVM_WRITE)
+			payload_write_done(req);
 		perf_report(req);
+		host_qd_update(&sim.hosts[req->hid], -1);
 		request_destroy(req);
 		fe_req_cq.outstanding--;
 		exe++;
 	}
+	g_timer.wake_time = host_wake_time();
 
 	if (!check_remaining_jobs()) {
 		update_and_print_bw();
@@ -3,24 +3,61 @@
 
 #include <sys/queue.h>
 #include <stdbool.h>
+#include "sim_lat.h"
+#include "sim_trace.h"
+#include "sim_dist.h"
 
 #define MAX_QUEUE_DEPTH			(1 << P_SLOT_TAG_WIDTH)
+#define MAX_WORKERS				10		// -n
 #define CMD_NONE 				(1 << 31)
+#define HOST_MAX_NBLKS			256		// one command, set_auto_*_dma() take cmd4KBOffset < 256
+#define SIZE_DIST_MAX			8
+
+#define REPLAY_OPEN				0		// trace timestamps are arrival times
+#define REPLAY_CLOSED			1		// timestamps ignored, the queue is kept full
+
+#define ARRIVAL_CLOSED			0		// a new command as soon as the queue has room
+#define ARRIVAL_CONST			1		// open loop at a fixed interval
+#define ARRIVAL_POISSON			2		// open loop, exponential gaps
+#define ARRIVAL_ONOFF			3		// poisson during on_us, then nothing for off_us
+#define ARRIVALS				4
+
+#define ADMIT_RR				0		// one command per worker in turn
+#define ADMIT_WRR				1		// weight commands per turn
+#define ADMIT_DRR				2		// weight * HOST_MAX_NBLKS blocks per turn, fair in bytes
+#define ADMITS					3
 
 struct job {
 	unsigned int hid;
 	unsigned int op;
 	unsigned int blkaddr;
 	unsigned int nblks;
+	unsigned long long time;	// arrival, latency counts from here
+};
+
+/* command sizes in 4KB blocks, the 4th -w field */
+struct size_dist {
+	unsigned int n;						// sizes listed, 1 for a fixed size
+	unsigned int range;					// uniform from nblks[0] to nblks[1] instead
+	unsigned int nblks[SIZE_DIST_MAX];
+	unsigned int weight[SIZE_DIST_MAX];	// running sum
 };
 
 struct host_config {
 	unsigned int min_lba;
 	unsigned int max_lba;
-	unsigned int nblks;
+	unsigned int nblks;		// largest command, the partition ends nblks after max_lba
+	struct size_dist sizes;
 	unsigned int op_read_pcent;
 	unsigned int op_write_pcent;
-	unsigned int pattern; //s 0 r 1
+	unsigned int pattern; //PATTERN_*
+	double param[2];	// of the skewed patterns, -w fields 5 and 6
+	unsigned int arrival;	// ARRIVAL_*, -A
+	double iops;
+	unsigned int on_us;
+	unsigned int off_us;
+	unsigned int qd;		// -Q, 0 for only the global -q
+	unsigned int weight;	// -Q, 0 counts as 1
 };
 
 struct host {
@@ -28,10 +65,36 @@ struct host {
 	struct host_config config;
 	unsigned int acc;
 	unsigned int next_blkaddr;
+	struct dist dist;
+	struct rng rng;				// --seed, stream hid
+	struct rng arrival_rng;		// own stream, the arrival process doesn't move the addresses
+	unsigned long long arrival;	// open loop: sim time the pending command arrives at
+	unsigned long long arrival_base;
+	double arrival_clock;		// us since arrival_base, on time only for ARRIVAL_ONOFF
+	unsigned int outstanding;	// sent and not completed
+	int credit;					// commands (blocks for ADMIT_DRR) left in this turn
+	unsigned long long issued[2];	// commands, blocks
+	unsigned long long qd_sum;	// outstanding integrated over time
+	unsigned long long qd_since;
+	unsigned long long qd_start;
 	unsigned int complete_blks[2]; //w 0 r 1
 	unsigned int last_complete_blks[2];
 	unsigned int complete_reqs[2]; //w 0 r 1
 	unsigned int last_complete_reqs[2];
+	struct lat_hist lat[2]; //w 0 r 1, since the last report
+	struct lat_hist lat_total[2];
+	struct lat_hist wait_total[2];	// arrival to submission to the device
+	struct lat_hist svc_total[2];	// submission to completion
+	struct trace *trace;				// replayed instead of pattern/op_*_pcent, NULL if none
+	unsigned long long trace_base;		// sim time the replay started at
+	unsigned long long trace_start;		// trace time of its first request
+	unsigned long long trace_time;		// pending request: arrival relative to trace_start
+	unsigned long long trace_blk;		// pending request: 4KB block before remapping and blocks left,
+	unsigned long long trace_nblks;		// larger requests go out in HOST_MAX_NBLKS pieces
+	unsigned int trace_op;
+	unsigned long long trace_cmds;
+	unsigned long long trace_late;		// open loop: arrivals held back by the queue depth
+	unsigned long long trace_wait;		// us they were held back in total
 };
 
 void init_hosts();
@@ -41,9 +104,17 @@ void request_send(struct nvme_request_entry *req);
 struct nvme_request_entry *request_recv();
 void request_destroy(struct nvme_request_entry *req);
 void update_and_print_bw();
+void show_lat_stats();
 unsigned int select_op(struct host *host);
-unsigned int get_next_blkaddr(struct host *host);
-struct job get_next_job();
+unsigned int get_next_blkaddr(struct host *host, unsigned int nblks);
+unsigned int select_nblks(struct host *host);
+int format_size_dist(const struct size_dist *sizes, char *buf, unsigned int len);
+struct host *get_next_host();
+struct job get_next_job(struct host *host);
+void init_traces();
+int host_open_loop(struct host *host);
+void show_worker_stats();
+void show_trace_stats();
 void perf_report(struct nvme_request_entry *req);
 bool check_remaining_jobs();
 int SchedulingHost();
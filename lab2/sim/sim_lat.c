@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_lat.h"
+
+const double lat_pcts[LAT_NPCTS] = {50, 90, 99, 99.9, 99.99};
+
+static const char *lat_pct_names[LAT_NPCTS] = {"p50", "p90", "p99", "p99.9", "p99.99"};
+
+/* highest value that lands in the bucket */
+static unsigned long long lat_bucket_high(unsigned int idx) {
+	unsigned int shift;
+
+	if (idx < (1U << LAT_SUB_BITS))
+		return idx;
+	shift = idx / LAT_HALF - 1;
+	return ((unsigned long long)(idx - shift * LAT_HALF) << shift) + (1ULL << shift) - 1;
+}
+
+void lat_hist_reset(struct lat_hist *h) {
+	memset(h, 0, sizeof(*h));
+}
+
+void lat_hist_merge(struct lat_hist *dst, const struct lat_hist *src) {
+	unsigned int i;
+
+	if (!src->count)
+		return;
+	for (i = 0; i < LAT_BUCKETS; i++)
+		dst->bucket[i] += src->bucket[i];
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/* one pass over the buckets for all of lat_pcts, values are capped at the exact max */
+void lat_hist_percentiles(const struct lat_hist *h, unsigned long long *out) {
+	unsigned long long rank, seen = 0;
+	unsigned int i, p = 0;
+
+	memset(out, 0, sizeof(unsigned long long) * LAT_NPCTS);
+	if (!h->count)
+		return;
+
+	for (i = 0; i < LAT_BUCKETS && p < LAT_NPCTS; i++) {
+		seen += h->bucket[i];
+		while (p < LAT_NPCTS) {
+			rank = (unsigned long long)(lat_pcts[p] / 100 * h->count + 0.999999);
+			if (rank < 1)
+				rank = 1;
+			if (seen < rank)
+				break;
+			out[p++] = lat_bucket_high(i) < h->max ? lat_bucket_high(i) : h->max;
+		}
+	}
+}
+
+int lat_hist_format(const struct lat_hist *h, char *buf, unsigned int len) {
+	unsigned long long v[LAT_NPCTS];
+	int n = 0, i;
+
+	lat_hist_percentiles(h, v);
+	for (i = 0; i < LAT_NPCTS; i++)
+		n += snprintf(buf + n, len - n, "%s%s %llu", i ? " " : "", lat_pct_names[i], v[i]);
+	n += snprintf(buf + n, len - n, " max %llu", h->max);
+	return n;
+}
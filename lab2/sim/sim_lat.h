@@ -0,0 +1,49 @@
+#ifndef SIM_LAT_H_
+#define SIM_LAT_H_
+
+/*
+ * Log-linear latency histogram (HDR style). Values below 2^LAT_SUB_BITS us
+ * get a bucket each, above that every power of two is split into
+ * 2^(LAT_SUB_BITS-1) buckets, so a bucket is within 1/64 of its value.
+ * Latencies of 2^LAT_MAX_BITS us and more share the last bucket, max stays exact.
+ */
+#define LAT_SUB_BITS				7
+#define LAT_MAX_BITS				40
+#define LAT_HALF					(1ULL << (LAT_SUB_BITS - 1))
+#define LAT_BUCKETS					((LAT_MAX_BITS - LAT_SUB_BITS + 2) * LAT_HALF)
+#define LAT_NPCTS					5
+
+struct lat_hist {
+	unsigned long long count;
+	unsigned long long sum;
+	unsigned long long max;
+	unsigned long long bucket[LAT_BUCKETS];
+};
+
+extern const double lat_pcts[LAT_NPCTS];		// 50 90 99 99.9 99.99
+
+static inline unsigned int lat_bucket(unsigned long long v) {
+	unsigned int shift;
+
+	if (v < (1ULL << LAT_SUB_BITS))
+		return v;
+	if (v >= (1ULL << LAT_MAX_BITS))
+		return LAT_BUCKETS - 1;
+	shift = 64 - __builtin_clzll(v) - LAT_SUB_BITS;
+	return shift * LAT_HALF + (v >> shift);
+}
+
+static inline void lat_hist_record(struct lat_hist *h, unsigned long long v) {
+	h->bucket[lat_bucket(v)]++;
+	h->count++;
+	h->sum += v;
+	if (v > h->max)
+		h->max = v;
+}
+
+void lat_hist_reset(struct lat_hist *h);
+void lat_hist_merge(struct lat_hist *dst, const struct lat_hist *src);
+void lat_hist_percentiles(const struct lat_hist *h, unsigned long long *out);
+int lat_hist_format(const struct lat_hist *h, char *buf, unsigned int len);
+
+#endif /* SIM_LAT_H_ */
@@ -3,15 +3,28 @@
 #include <getopt.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
 
 #include "sim_main.h"
 #include "sim_host.h"
 #include "sim_frontend.h"
 #include "sim_backend.h"
+#include "sim_timing.h"
+#include "sim_payload.h"
+#include "sim_hist.h"
+#include "sim_snapshot.h"
+#include "sim_stall.h"
+#include "sim_rand.h"
 #include "address_translation.h"
 #include "request_transform.h"
+#include "garbage_collection.h"
+#include "data_buffer.h"
 /* CSV/WAF saver implemented in sim_host.c */
 void save_gc_stats(const char *output_dir);
+/* FTL summary counters, address_translation.c / garbage_collection.c */
+extern void TsGcGetSummary(uint64_t *gc_selects, uint64_t *gc_valid_sum);
+extern void TsResetSummary(void);
 
 
 struct sim sim;
@@ -20,9 +33,29 @@ void init_sim_config() {
 	sim.config.nhosts = 1;
 	sim.config.parts_pcent = NULL;
 	sim.config.precond = 0;
+	sim.config.age = 0;
 	sim.config.report = 0;
 	sim.config.output_dir = NULL;
 	sim.config.nops = 5000000;
+	sim.config.bus_mts = 0;
+	sim.config.gc_bg = 0;
+	sim.config.gc_step = USER_PAGES_PER_BLOCK;
+	sim.config.gc_victim = GC_VICTIM_GREEDY;
+	sim.config.gc_window = 8;
+	sim.config.hotcold = 0;
+	sim.config.gc_bufs = 1;
+	sim.config.payload = NULL;
+	sim.config.save = NULL;
+	sim.config.restore = NULL;
+	sim.config.hist_format = HIST_FORMAT_CSV;
+	sim.config.breakdown = 0;
+	sim.config.ntraces = 0;
+	sim.config.replay = REPLAY_OPEN;
+	sim.config.qd = MAX_QUEUE_DEPTH;
+	sim.config.seed = 1;
+	sim.config.narrivals = 0;
+	sim.config.nqds = 0;
+	sim.config.sched = ADMIT_RR;
 }
 
 void parse_listed_arg(char *optarg, int len, unsigned int *listed_arg) {
@@ -40,28 +73,175 @@ void parse_listed_arg(char *optarg, int len, unsigned int *listed_arg) {
 	}
 }
 
+/* "16" blocks or "64K"/"1M" bytes, 0 if it isn't 1 ~ HOST_MAX_NBLKS blocks */
+static unsigned int parse_size(const char *str, char **end) {
+	unsigned long long size = strtoull(str, end, 10);
+
+	if (**end == 'K' || **end == 'k' || **end == 'M' || **end == 'm') {
+		size <<= (**end == 'K' || **end == 'k') ? 10 : 20;
+		(*end)++;
+		if (size % BYTES_PER_NVME_BLOCK)
+			return 0;
+		size /= BYTES_PER_NVME_BLOCK;
+	}
+	return *end != str && size && size <= HOST_MAX_NBLKS ? size : 0;
+}
+
+/* fixed "size", uniform "size-size" or weighted "size:weight,size:weight,..." */
+static int parse_size_dist(const char *spec, struct host_config *config) {
+	struct size_dist *sizes = &config->sizes;
+	const char *p = spec;
+	unsigned int w, total = 0;
+	char *end;
+
+	sizes->n = 0;
+	sizes->range = 0;
+	while (1) {
+		if (sizes->n == SIZE_DIST_MAX)
+			return 0;
+		sizes->nblks[sizes->n] = parse_size(p, &end);
+		if (!sizes->nblks[sizes->n])
+			return 0;
+		w = 1;
+		if (*end == '-' && !sizes->n) {
+			sizes->range = 1;
+		} else if (*end == ':' && !sizes->range) {
+			w = strtoul(end + 1, &end, 10);
+			if (!w)
+				return 0;
+		}
+		total += w;
+		sizes->weight[sizes->n++] = total;
+		if (!*end)
+			break;
+		if (*end != ',' && !(*end == '-' && sizes->range))
+			return 0;
+		p = end + 1;
+	}
+	if (sizes->range && (sizes->n != 2 || sizes->nblks[1] < sizes->nblks[0]))
+		return 0;
+
+	config->nblks = 0;
+	for (w = 0; w < sizes->n; w++)
+		if (sizes->nblks[w] > config->nblks)
+			config->nblks = sizes->nblks[w];
+	return 1;
+}
+
+const char *arrival_names[ARRIVALS] = {"closed", "const", "poisson", "onoff"};
+
+/* "closed", "const <IOPS>", "poisson <IOPS>" or "onoff <IOPS> <on ms> <off ms>" */
+static int parse_arrival(const char *arg, struct host_config *config) {
+	char kind[16];
+	unsigned int on_ms = 0, off_ms = 0;
+	double iops = 0;
+	int n;
+
+	n = sscanf(arg, "%15s %lf %u %u", kind, &iops, &on_ms, &off_ms);
+	for (config->arrival = 0; config->arrival < ARRIVALS; config->arrival++)
+		if (n >= 1 && !strcmp(kind, arrival_names[config->arrival]))
+			break;
+	switch (config->arrival) {
+	case ARRIVAL_CLOSED:
+		return n == 1;
+	case ARRIVAL_CONST:
+	case ARRIVAL_POISSON:
+		config->iops = iops;
+		return n == 2 && iops > 0;
+	case ARRIVAL_ONOFF:
+		config->iops = iops;
+		config->on_us = on_ms * 1000;
+		config->off_us = off_ms * 1000;
+		return n == 4 && iops > 0 && on_ms && on_ms < 4000000 && off_ms < 4000000;
+	default:
+		return 0;
+	}
+}
+
+/* theta > 0, 0 <= ops% <= 100 and 0 < blocks% < 100, 0 < h < 1 */
+static int check_pattern_params(struct host_config *config) {
+	switch (config->pattern) {
+	case PATTERN_ZIPF:
+		return config->param[0] > 0;
+	case PATTERN_PARETO:
+		return config->param[0] > 0 && config->param[0] < 1;
+	case PATTERN_HOTCOLD:
+		return config->param[0] >= 0 && config->param[0] <= 100 && config->param[1] > 0 && config->param[1] < 100;
+	default:
+		return 1;
+	}
+}
+
+/* "greedy", "cb", "cat" or "rgreedy[:candidates]" */
+static void parse_victim_policy(const char *arg) {
+	unsigned int policy;
+	size_t len;
+	char *end;
+
+	for (policy = 0; policy < GC_VICTIM_POLICIES; policy++) {
+		len = strlen(gcVictimPolicyNames[policy]);
+		if (!strncmp(arg, gcVictimPolicyNames[policy], len) && (!arg[len] || (policy == GC_VICTIM_RGREEDY && arg[len] == ':')))
+			break;
+	}
+	if (policy == GC_VICTIM_POLICIES) {
+		fprintf(stderr, "Invalid GC victim policy %s.\n", arg);
+		exit(1);
+	}
+	sim.config.gc_victim = policy;
+	if (policy != GC_VICTIM_RGREEDY || !arg[len])
+		return;
+	sim.config.gc_window = strtoul(arg + len + 1, &end, 0);
+	if (*end || !sim.config.gc_window || sim.config.gc_window > 64) {
+		fprintf(stderr, "Invalid rgreedy candidates %s, 1 ~ 64.\n", arg + len + 1);
+		exit(1);
+	}
+}
+
 void argparser(int argc, char *argv[]) {
     int opt;
 	int opt_idx = 0;
 	int host_idx = 0;
 	unsigned int arrarg[10];
 	unsigned int aarg;
+	double params[2];
+	int nparams, i;
+	char *end, spec[64];
 	struct option long_options[] = {
 		{"size", optional_argument, NULL, 's'},
 		{"nworkers", required_argument, NULL, 'n'},
-		{"worker", optional_argument, NULL, 'w'}, // "pattern, rp, wp, nblks"
+		{"worker", optional_argument, NULL, 'w'}, // "pattern, rp, wp, nblks[, param, param]"
 		{"inst", required_argument, NULL, 'i'}, 
 		{"condition", no_argument, NULL, 'c'},
+		{"age", required_argument, NULL, 'a'}, // random full-drive overwrites after precondition
 		{"outputdir", optional_argument, NULL, 'o'},
 		{"report", no_argument, NULL, 'r'},
+		{"nand", required_argument, NULL, 't'}, // preset name or profile file
+		{"bus", required_argument, NULL, 'b'}, // channel MT/s
+		{"bggc", required_argument, NULL, 'g'}, // background GC below this many free blocks per die
+		{"gcstep", required_argument, NULL, 'k'}, // copies per background GC step
+		{"victim", required_argument, NULL, 'v'}, // GC victim policy
+		{"hotcold", no_argument, NULL, 'H'}, // hot/cold/GC open blocks per die
+		{"gcbufs", required_argument, NULL, 'G'}, // temp buffer entries per die for GC copies
+		{"payload", required_argument, NULL, 'p'}, // NAND image file or "anon"
+		{"save", required_argument, NULL, 'S'}, // snapshot FTL state at exit
+		{"restore", required_argument, NULL, 'R'}, // start from a snapshot
+		{"format", required_argument, NULL, 'f'}, // lat/perf history: csv or bin
+		{"breakdown", no_argument, NULL, 'B'}, // stall columns in the lat history
+		{"trace", required_argument, NULL, 'T'}, // replay a block trace on the next worker
+		{"replay", required_argument, NULL, 'm'}, // trace timing: open or closed
+		{"qd", required_argument, NULL, 'q'}, // outstanding commands
+		{"seed", required_argument, NULL, 'e'}, // worker address streams
+		{"arrival", required_argument, NULL, 'A'}, // open loop arrivals of the next worker
+		{"wqd", required_argument, NULL, 'Q'}, // "qd, weight" of the next worker
+		{"sched", required_argument, NULL, 'W'}, // rr, wrr or drr admission
 		{0, 0, 0, 0}
 	};
 
-    while ((opt = getopt_long(argc, argv, "n:w:s:i:o:cr", long_options, &opt_idx)) != -1) {
+    while ((opt = getopt_long(argc, argv, "n:w:s:i:o:t:b:g:k:v:G:p:S:R:a:f:T:m:q:e:A:Q:W:crBH", long_options, &opt_idx)) != -1) {
         switch (opt) {
             case 'n':
 				aarg = atoi(optarg);
-				if (aarg > 10) {
+				if (aarg > MAX_WORKERS) {
 					fprintf(stderr, "Too many workers %d.\n", aarg);
 					exit(1);
 				}
@@ -77,12 +257,29 @@ void argparser(int argc, char *argv[]) {
 					fprintf(stderr, "Can't create worker[%d]. nworkers is %d\n", host_idx, sim.config.nhosts);
 					exit(1);
 				}
-				parse_listed_arg(optarg, 4, arrarg);
+				nparams = sscanf(optarg, "%*s %*s %*s %63s %lf %lf", spec, &params[0], &params[1]) - 1;
+				parse_listed_arg(optarg, 6, arrarg);
 				if (arrarg[1] + arrarg[2] != 100) {
 					fprintf(stderr, "Invalid option for worker[%d] read[%d] write[%d] pcents.\n", host_idx, arrarg[1], arrarg[2]);
 					exit(1);
 				}
+				if (arrarg[0] >= PATTERNS) {
+					fprintf(stderr, "Invalid pattern %d for worker[%d].\n", arrarg[0], host_idx);
+					exit(1);
+				}
 				init_host_config(&(sim.hosts[host_idx].config), arrarg);
+				if (nparams < 0 || !parse_size_dist(spec, &(sim.hosts[host_idx].config))) {
+					fprintf(stderr, "Invalid size %s for worker[%d], 1 ~ %d blocks or 4K ~ %dK each.\n", nparams < 0 ? "" : spec, host_idx,
+							HOST_MAX_NBLKS, HOST_MAX_NBLKS * 4);
+					exit(1);
+				}
+				for (i = 0; i < nparams; i++)
+					sim.hosts[host_idx].config.param[i] = params[i];
+				if (!check_pattern_params(&(sim.hosts[host_idx].config))) {
+					fprintf(stderr, "Invalid %s parameters %g %g for worker[%d].\n", pattern_names[arrarg[0]],
+							sim.hosts[host_idx].config.param[0], sim.hosts[host_idx].config.param[1], host_idx);
+					exit(1);
+				}
 				host_idx++;
                 break;
             case 's':
@@ -97,15 +294,157 @@ void argparser(int argc, char *argv[]) {
             case 'c':
 				sim.config.precond = 1;
 				break;
+            case 'a':
+				sim.config.age = strtoul(optarg, &end, 0);
+				if (*end || !sim.config.age || sim.config.age > 100) {
+					fprintf(stderr, "Invalid aging passes %s, 1 ~ 100.\n", optarg);
+					exit(1);
+				}
+				sim.config.precond = 1;
+				break;
             case 'r':
 				sim.config.report = 1;
 				break;
+			case 'B':
+				sim.config.breakdown = 1;
+				break;
+			case 'T':
+				if (sim.config.ntraces == MAX_WORKERS) {
+					fprintf(stderr, "Too many traces.\n");
+					exit(1);
+				}
+				sim.config.trace[sim.config.ntraces++] = strdup(optarg);
+				break;
+			case 'm':
+				if (!strcmp(optarg, "open"))
+					sim.config.replay = REPLAY_OPEN;
+				else if (!strcmp(optarg, "closed"))
+					sim.config.replay = REPLAY_CLOSED;
+				else {
+					fprintf(stderr, "Invalid replay mode %s.\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'q':
+				sim.config.qd = atoi(optarg);
+				if (!sim.config.qd || sim.config.qd > MAX_QUEUE_DEPTH) {
+					fprintf(stderr, "Invalid queue depth %s, 1 ~ %d.\n", optarg, MAX_QUEUE_DEPTH);
+					exit(1);
+				}
+				break;
+			case 'A':
+				if (!sim.hosts) {
+					fprintf(stderr, "Please set nworkers with -n before -A.\n");
+					exit(1);
+				}
+				if (sim.config.narrivals == sim.config.nhosts) {
+					fprintf(stderr, "Can't set arrivals of worker[%d]. nworkers is %d\n", sim.config.narrivals, sim.config.nhosts);
+					exit(1);
+				}
+				if (!parse_arrival(optarg, &(sim.hosts[sim.config.narrivals].config))) {
+					fprintf(stderr, "Invalid arrivals \"%s\" for worker[%d].\n", optarg, sim.config.narrivals);
+					exit(1);
+				}
+				sim.config.narrivals++;
+				break;
+			case 'Q':
+				if (!sim.hosts) {
+					fprintf(stderr, "Please set nworkers with -n before -Q.\n");
+					exit(1);
+				}
+				if (sim.config.nqds == sim.config.nhosts) {
+					fprintf(stderr, "Can't set queue depth of worker[%d]. nworkers is %d\n", sim.config.nqds, sim.config.nhosts);
+					exit(1);
+				}
+				arrarg[0] = 0;
+				arrarg[1] = 1;
+				parse_listed_arg(optarg, 2, arrarg);
+				if (!arrarg[0] || arrarg[0] > MAX_QUEUE_DEPTH || !arrarg[1] || arrarg[1] > 1000) {
+					fprintf(stderr, "Invalid queue depth/weight \"%s\" for worker[%d], 1 ~ %d and 1 ~ 1000.\n", optarg, sim.config.nqds, MAX_QUEUE_DEPTH);
+					exit(1);
+				}
+				sim.hosts[sim.config.nqds].config.qd = arrarg[0];
+				sim.hosts[sim.config.nqds].config.weight = arrarg[1];
+				sim.config.nqds++;
+				break;
+			case 'W':
+				if (!strcmp(optarg, "rr"))
+					sim.config.sched = ADMIT_RR;
+				else if (!strcmp(optarg, "wrr"))
+					sim.config.sched = ADMIT_WRR;
+				else if (!strcmp(optarg, "drr"))
+					sim.config.sched = ADMIT_DRR;
+				else {
+					fprintf(stderr, "Invalid scheduler %s.\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'e':
+				sim.config.seed = strtoull(optarg, &end, 0);
+				if (*end) {
+					fprintf(stderr, "Invalid seed %s.\n", optarg);
+					exit(1);
+				}
+				break;
 			case 'o':
 				sim.config.output_dir = strdup(optarg);
 				break;
 			case 'i':
 				sim.config.nops = atoi(optarg);
 				break;
+			case 't':
+				set_nand_timing(optarg);
+				break;
+			case 'b':
+				sim.config.bus_mts = strtoul(optarg, &end, 0);
+				if (*end || !sim.config.bus_mts || sim.config.bus_mts > NAND_BUS_MTS_MAX) {
+					fprintf(stderr, "Invalid bus speed %s, 1 ~ %d MT/s.\n", optarg, NAND_BUS_MTS_MAX);
+					exit(1);
+				}
+				break;
+			case 'g':
+				sim.config.gc_bg = strtoul(optarg, &end, 0);
+				if (*end || sim.config.gc_bg > USER_BLOCKS_PER_DIE) {
+					fprintf(stderr, "Invalid background GC watermark %s, 0 ~ %d free blocks per die.\n", optarg, USER_BLOCKS_PER_DIE);
+					exit(1);
+				}
+				break;
+			case 'k':
+				sim.config.gc_step = strtoul(optarg, &end, 0);
+				if (*end || !sim.config.gc_step || sim.config.gc_step > USER_PAGES_PER_BLOCK) {
+					fprintf(stderr, "Invalid GC step %s, 1 ~ %d copies.\n", optarg, USER_PAGES_PER_BLOCK);
+					exit(1);
+				}
+				break;
+			case 'v':
+				parse_victim_policy(optarg);
+				break;
+			case 'H':
+				sim.config.hotcold = 1;
+				break;
+			case 'G':
+				sim.config.gc_bufs = strtoul(optarg, &end, 0);
+				if (*end || !sim.config.gc_bufs || sim.config.gc_bufs > TEMPORARY_DATA_BUFFER_ENTRIES_PER_DIE) {
+					fprintf(stderr, "Invalid GC buffer count %s, 1 ~ %d entries per die.\n", optarg, TEMPORARY_DATA_BUFFER_ENTRIES_PER_DIE);
+					exit(1);
+				}
+				break;
+			case 'p':
+				sim.config.payload = strdup(optarg);
+				break;
+			case 'S':
+				sim.config.save = strdup(optarg);
+				break;
+			case 'R':
+				sim.config.restore = strdup(optarg);
+				break;
+			case 'f':
+				sim.config.hist_format = hist_parse_format(optarg);
+				if (sim.config.hist_format < 0) {
+					fprintf(stderr, "Invalid history format %s.\n", optarg);
+					exit(1);
+				}
+				break;
             default:
 				perror("Wrong usage TnT\n");
 				exit(1);
@@ -131,36 +470,75 @@ void fill_host_config() {
 }
 
 void show_configs() {
+	char sizes[128];
+
 	printf("%d workers\n", sim.config.nhosts);
 	for (int i = 0; i < sim.config.nhosts; i++) {
-		printf("  Worker[%d]: %d r%d w%d nblks%d\n", i, sim.hosts[i].config.pattern, sim.hosts[i].config.op_read_pcent, sim.hosts[i].config.op_write_pcent, sim.hosts[i].config.nblks);
+		format_size_dist(&sim.hosts[i].config.sizes, sizes, sizeof(sizes));
+		if (sim.hosts[i].trace)
+			printf("  Worker[%d]: trace %s (%s, %s loop)\n", i, sim.hosts[i].trace->path, trace_format_names[sim.hosts[i].trace->format],
+					sim.config.replay == REPLAY_OPEN ? "open" : "closed");
+		else if (sim.hosts[i].config.pattern == PATTERN_HOTCOLD)
+			printf("  Worker[%d]: %d r%d w%d nblks%s (%s %g%% of ops to %g%% of blocks)\n", i, sim.hosts[i].config.pattern, sim.hosts[i].config.op_read_pcent, sim.hosts[i].config.op_write_pcent, sizes,
+					pattern_names[sim.hosts[i].config.pattern], sim.hosts[i].config.param[0], sim.hosts[i].config.param[1]);
+		else if (sim.hosts[i].config.pattern >= PATTERN_ZIPF)
+			printf("  Worker[%d]: %d r%d w%d nblks%s (%s %g)\n", i, sim.hosts[i].config.pattern, sim.hosts[i].config.op_read_pcent, sim.hosts[i].config.op_write_pcent, sizes,
+					pattern_names[sim.hosts[i].config.pattern], sim.hosts[i].config.param[0]);
+		else
+			printf("  Worker[%d]: %d r%d w%d nblks%s\n", i, sim.hosts[i].config.pattern, sim.hosts[i].config.op_read_pcent, sim.hosts[i].config.op_write_pcent, sizes);
+		if (sim.hosts[i].config.arrival == ARRIVAL_ONOFF)
+			printf("   - arrivals: %s %g IOPS, %u ms on / %u ms off\n", arrival_names[ARRIVAL_ONOFF], sim.hosts[i].config.iops, sim.hosts[i].config.on_us / 1000, sim.hosts[i].config.off_us / 1000);
+		else if (sim.hosts[i].config.arrival)
+			printf("   - arrivals: %s %g IOPS\n", arrival_names[sim.hosts[i].config.arrival], sim.hosts[i].config.iops);
+		if (sim.hosts[i].config.qd || sim.hosts[i].config.weight > 1)
+			printf("   - queue depth %u, weight %u\n", sim.hosts[i].config.qd ? sim.hosts[i].config.qd : sim.config.qd,
+					sim.hosts[i].config.weight ? sim.hosts[i].config.weight : 1);
 		printf("   - partition: %d GB ~ %d GB\n", sim.hosts[i].config.min_lba / (1000000000 / 4096), (sim.hosts[i].config.max_lba + sim.hosts[i].config.nblks) / (1000000000 / 4096));
 	}
+	if (sim.config.qd != MAX_QUEUE_DEPTH)
+		printf("Queue depth %u\n", sim.config.qd);
 	printf("Precondition %d\n", sim.config.precond);
+	if (sim.config.age)
+		printf("Aged %u passes\n", sim.config.age);
+	if (sim.config.gc_victim == GC_VICTIM_RGREEDY)
+		printf("GC victim policy %s, %u candidates\n", gcVictimPolicyNames[sim.config.gc_victim], sim.config.gc_window);
+	else if (sim.config.gc_victim != GC_VICTIM_GREEDY)
+		printf("GC victim policy %s\n", gcVictimPolicyNames[sim.config.gc_victim]);
+	if (sim.config.hotcold)
+		printf("Hot/cold write streams, hot after %d writes\n", HOT_SLICE_WRITE_CNT);
+	if (sim.config.gc_bufs > 1)
+		printf("GC temp buffers %u per die\n", sim.config.gc_bufs);
+	if (sim.config.gc_bg)
+		printf("Background GC below %u free blocks per die, %u copies per step\n", sim.config.gc_bg, sim.config.gc_step);
 	printf("Report %d\n", sim.config.report);
 	printf("Total OPs %d\n", sim.config.nops);
-}
-
-void flush_hist_to_file(int idx) {
-	if (sim.config.report) {
-		for (int i = 0; i < sim.hist_idx[idx]; i++) {
-			fprintf(sim.fp[idx], "%llu,%llu,%llu,%llu,%llu,%llu\n", sim.hist[idx][i][0], sim.hist[idx][i][1], sim.hist[idx][i][2], sim.hist[idx][i][3], sim.hist[idx][i][4], sim.hist[idx][i][5]);
-		}
-	}
+	printf("Seed %llu\n", sim.config.seed);
+	show_nand_timing();
+	if (sim.config.payload)
+		printf("Payload %s\n", sim.config.payload);
+	if (sim.config.restore)
+		printf("Restored from %s\n", sim.config.restore);
 }
 
 void sim_cleanup() {
+	if (sim.config.save)
+		save_snapshot(sim.config.save);
+	show_bus_stats();
+	show_poll_stats();
+	show_dma_stats();
+	show_lat_stats();
+	show_stall_stats();
+	show_trace_stats();
+	show_worker_stats();
+	show_payload_stats();
+	show_mem_usage();
+	stop_hist_writer();
+
 	if (!sim.config.report)
 		return;
 
-	/* Step 4: write GC/WAF CSV before closing logs */
-save_gc_stats(sim.config.output_dir ? sim.config.output_dir : ".");
-
-for (int i = 0; i < 2; i++) {
-		flush_hist_to_file(i);
-		fflush(sim.fp[i]);
-		fclose(sim.fp[i]);
-	}
+	/* Step 4: write GC/WAF CSV */
+	save_gc_stats(sim.config.output_dir ? sim.config.output_dir : ".");
 }
 
 void precond_mappings() {
@@ -219,39 +597,61 @@ void precond_mappings() {
 	}
 }
 
-void create_log_files () {
-	FILE *fp1, *fp2;
-	char path1[512], path2[512];
-	char *prefix;
-
-	if (!sim.config.output_dir)
-		prefix = strdup(".");
-	else 
-		prefix = strdup(sim.config.output_dir);
-
-	snprintf(path1, sizeof(path1), "%s/lat.csv", prefix);
-	fp1 = fopen(path1, "w");
-	if (fp1 == NULL) {
-		fprintf(stderr, "Failed to open %s.\n", path1);
-		exit(1);
-	}
-	snprintf(path2, sizeof(path2), "%s/perf.csv", prefix);
-	fp2 = fopen(path2, "w");
-	if (fp2 == NULL) {
-		fprintf(stderr, "Failed to open %s.\n", path1);
-		fclose(fp1);
-		exit(1);
+/*
+ * Random slice overwrites of the whole drive, run through the FTL's own
+ * AddrTransWrite()/GarbageCollection() with mappingOnly set, so only the
+ * tables move and no time passes. The drive reaches GC steady state in
+ * seconds instead of simulated hours, then the timed run starts from it.
+ */
+void age_mappings(unsigned int passes) {
+	unsigned long long i, nwrites = (unsigned long long)LOGICAL_SLICE_MAX * passes;
+	struct rng rng;
+	uint64_t gc, copies;
+	unsigned int dieNo, blockNo;
+	P_ROW_ADDR_DEPENDENCY_ENTRY dep;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	rng_seed(&rng, sim.config.seed, 3ULL << 32);	// independent of the host and GC streams
+	mappingOnly = 1;
+	for (i = 0; i < nwrites; i++)
+		AddrTransWrite(rng_below(&rng, LOGICAL_SLICE_MAX));
+	mappingOnly = 0;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	/* every programmed page is on NAND, erased blocks start over */
+	for (dieNo = 0; dieNo < USER_DIES; dieNo++) {
+		dep = rowAddrDependencyTablePtr->block[Vdie2PchTranslation(dieNo)][Vdie2PwayTranslation(dieNo)];
+		for (blockNo = 0; blockNo < USER_BLOCKS_PER_DIE; blockNo++) {
+			dep[blockNo].permittedProgPage = virtualBlockMapPtr->block[dieNo][blockNo].currentPage;
+			dep[blockNo].blockedReadReqCnt = 0;
+			dep[blockNo].blockedEraseReqFlag = 0;
+		}
 	}
-	sim.fp[0] = fp1;
-	sim.fp[1] = fp2;
 
-	free(prefix);
+	TsGcGetSummary(&gc, &copies);
+	printf("Aging: %llu writes, GC %llu, copies %llu, WAF %.3f (%.1fs)\n", nwrites, (unsigned long long)gc, (unsigned long long)copies,
+			nwrites ? (double)(nwrites + copies) / nwrites : 1.0,
+			(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+	/* the timed run reports its own writes and GC */
+	TsResetSummary();
+	init_stall();
 }
 
 void init_sim(int argc, char *argv[]) {
 	sim.hosts = NULL;
 	init_sim_config();
 	argparser(argc, argv);
+	if (sim.config.bus_mts)
+		g_nand_timing.bus_mts = sim.config.bus_mts;
+	gcBgFreeBlocks = sim.config.gc_bg;
+	gcCopiesPerStep = sim.config.gc_step;
+	gcVictimPolicy = sim.config.gc_victim;
+	gcVictimWindow = sim.config.gc_window;
+	rng_seed(&gcRng, sim.config.seed, 2ULL << 32);	// workers use streams hid and hid + 2^32
+	writeStreamsEnabled = sim.config.hotcold;
+	tempDataBufPerDie = sim.config.gc_bufs;
 	if (!sim.hosts) {
 		if (sim.config.nhosts != 1) {
 			fprintf(stderr, "Unset option: w\n");
@@ -263,19 +663,33 @@ void init_sim(int argc, char *argv[]) {
 			init_host_config(&(sim.hosts[i].config), seq_write_16k);
 	}
 	fill_host_config();
+	init_traces();
 
 	if (sim.config.report)
-		create_log_files();
+		init_hist_writer(sim.config.output_dir, sim.config.hist_format, sim.config.breakdown ? HIST_FIELDS + STALL_KINDS : HIST_FIELDS);
 	sim.last_report_time = 0;
 	sim.initial_report_time = 0;
 	sim.next_hid = 0;
 	sim.remaining_jobs = sim.config.nops;
+	if (sim.config.precond && sim.config.restore) {
+		fprintf(stderr, "Precondition and restore can't be combined.\n");
+		exit(1);
+	}
 	if (sim.config.precond)
 		precond_mappings();
+	InitGcVictimIndex();
+	if (sim.config.age)
+		age_mappings(sim.config.age);
+	if (sim.config.payload)
+		init_payload(sim.config.payload);
 
 	show_configs();
 
 	init_hosts();
+	if (sim.config.restore) {
+		restore_snapshot(sim.config.restore);
+		InitGcVictimIndex();	// derived from the restored victim lists, not saved
+	}
 	init_fe();
 }
 
@@ -4,7 +4,6 @@
 #include "sim_host.h"
 #include "ftl_config.h"
 
-#define HIST_BUF_MAX				10000000
 #define MAX_LBA						storageCapacity_L 
 #define LOGICAL_SLICE_MAX 			(storageCapacity_L / NVME_BLOCKS_PER_SLICE)
 #define LOGICAL_BLOCK_MAX			(LOGICAL_SLICE_MAX / USER_PAGES_PER_BLOCK)
@@ -16,9 +15,30 @@ struct sim_config {
 	int nhosts;
 	int *parts_pcent;
 	int precond;
+	unsigned int age;
 	int report;
 	int nops;
 	char *output_dir;
+	unsigned int bus_mts;
+	unsigned int gc_bg;		// background GC watermark, free blocks per die
+	unsigned int gc_step;	// copies per background GC step
+	unsigned int gc_victim;	// GC_VICTIM_*
+	unsigned int gc_window;	// candidates of GC_VICTIM_RGREEDY
+	int hotcold;			// separate hot, cold and GC write streams
+	unsigned int gc_bufs;	// temp buffer entries per die for GC copies
+	char *payload;
+	char *save;
+	char *restore;
+	int hist_format;
+	int breakdown;
+	char *trace[MAX_WORKERS];	// per worker, in -T order
+	int ntraces;
+	int replay;
+	int narrivals;			// workers given an arrival process with -A
+	int nqds;				// workers given a queue depth with -Q
+	int sched;				// ADMIT_*, which worker fills a free queue slot
+	unsigned int qd;		// outstanding commands, all workers
+	unsigned long long seed;
 };
 
 struct sim {
@@ -28,9 +48,6 @@ struct sim {
 	int next_hid;
 	unsigned int remaining_jobs;
 	struct host *hosts;
-	FILE *fp[2];
-	volatile unsigned int hist_idx[2];
-	volatile unsigned long long hist[2][HIST_BUF_MAX][6]; // LATENCY(time hid op lat lba nblks) PERF(time hid rb wb crb cwb)
 };
 
 void init_sim_config();
@@ -38,9 +55,9 @@ void parse_listed_arg(char *optarg, int len, unsigned int *listed_arg);
 void argparser(int argc, char *argv[]);
 void fill_host_config();
 void show_configs();
-void flush_hist_to_file(int idx);
 void sim_cleanup();
 void precond_mappings();
+void age_mappings(unsigned int passes);
 void init_sim(int argc, char *argv[]);
 
 extern struct sim sim;
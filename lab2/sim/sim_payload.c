@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sim_main.h"
+#include "sim_frontend.h"
+#include "sim_backend.h"
+#include "sim_payload.h"
+#include "request_schedule.h"
+#include "host_lld.h"
+
+struct payload g_payload;
+
+#define PAYLOAD_WORDS_PER_BLOCK		(BYTES_PER_NVME_BLOCK / sizeof(unsigned long long))
+#define PAYLOAD_WORD(seed, i)		((seed) * 0x9e3779b97f4a7c15ULL + (i))
+
+/*
+ * "anon" keeps the NAND image in anonymous memory, anything else is a file
+ * that is recreated as a sparse image on every run. Erased pages read back
+ * as zeros, matching the zero-filled g_mem the FTL sees without payload.
+ */
+void init_payload(const char *path) {
+	int fd;
+
+	memset(&g_payload, 0, sizeof(g_payload));
+
+	if (!strcmp(path, "anon")) {
+		g_payload.image = mmap(NULL, PAYLOAD_IMAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	} else {
+		fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || ftruncate(fd, PAYLOAD_IMAGE_SIZE)) {
+			fprintf(stderr, "Failed to create NAND image %s.\n", path);
+			exit(1);
+		}
+		g_payload.image = mmap(NULL, PAYLOAD_IMAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+		close(fd);
+		g_payload.file = 1;
+	}
+	if (g_payload.image == MAP_FAILED) {
+		fprintf(stderr, "Failed to map NAND image %s.\n", path);
+		exit(1);
+	}
+
+	g_payload.lba = mmap(NULL, sizeof(struct payload_lba) * (unsigned long long)MAX_LBA, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (g_payload.lba == MAP_FAILED) {
+		fprintf(stderr, "Failed to allocate payload LBA table.\n");
+		exit(1);
+	}
+
+	g_payload.enabled = 1;
+}
+
+static unsigned char *payload_row(unsigned int ch, unsigned int way, unsigned int rowAddr) {
+	unsigned long long row;
+
+	row = (rowAddr / LUN_1_BASE_ADDR) * (TOTAL_BLOCKS_PER_LUN * PAGES_PER_MLC_BLOCK) + (rowAddr % LUN_1_BASE_ADDR);
+	row += (unsigned long long)(ch * USER_WAYS + way) * PAYLOAD_ROWS_PER_DIE;
+
+	return g_payload.image + row * PAYLOAD_ROW_STRIDE;
+}
+
+static int payload_zero(const unsigned char *buf, unsigned int len) {
+	const unsigned long long *word = (const unsigned long long *)buf;
+	unsigned int i;
+
+	for (i = 0; i < len / sizeof(unsigned long long); i++)
+		if (word[i])
+			return 0;
+	return 1;
+}
+
+/*
+ * Data/spare addresses in the NSC registers are g_mem offsets (g_mem is 4GB
+ * aligned). A row is only programmed after its block was erased, so zero
+ * data (preconditioned slices moved by GC) leaves the image untouched.
+ */
+void payload_program(unsigned int ch, unsigned int way, unsigned int rowAddr, unsigned int dataAddr, unsigned int spareAddr) {
+	unsigned char *row = payload_row(ch, way, rowAddr);
+	unsigned char *data = Addr2Mem(unsigned char, dataAddr);
+	unsigned char *spare = Addr2Mem(unsigned char, spareAddr);
+
+	if (!payload_zero(data, BYTES_PER_DATA_REGION_OF_PAGE))
+		memcpy(row, data, BYTES_PER_DATA_REGION_OF_PAGE);
+	if (!payload_zero(spare, BYTES_PER_SPARE_REGION_OF_PAGE))
+		memcpy(row + BYTES_PER_DATA_REGION_OF_NAND_ROW, spare, BYTES_PER_SPARE_REGION_OF_PAGE);
+}
+
+void payload_read(unsigned int ch, unsigned int way, unsigned int rowAddr, unsigned int dataAddr, unsigned int spareAddr) {
+	unsigned char *row = payload_row(ch, way, rowAddr);
+
+	memcpy(Addr2Mem(unsigned char, dataAddr), row, BYTES_PER_DATA_REGION_OF_PAGE);
+	memcpy(Addr2Mem(unsigned char, spareAddr), row + BYTES_PER_DATA_REGION_OF_NAND_ROW, BYTES_PER_SPARE_REGION_OF_PAGE);
+}
+
+void payload_read_raw(unsigned int ch, unsigned int way, unsigned int rowAddr, unsigned int dataAddr) {
+	memcpy(Addr2Mem(unsigned char, dataAddr), payload_row(ch, way, rowAddr), BYTES_PER_NAND_ROW);
+}
+
+/* drop the block's rows so the image stays as sparse as the live data */
+void payload_erase(unsigned int ch, unsigned int way, unsigned int rowAddr) {
+	unsigned char *block = payload_row(ch, way, rowAddr - rowAddr % PAGES_PER_MLC_BLOCK);
+	unsigned long long len = (unsigned long long)PAGES_PER_MLC_BLOCK * PAYLOAD_ROW_STRIDE;
+
+	if (!g_payload.file)
+		madvise(block, len, MADV_DONTNEED);
+	else if (madvise(block, len, MADV_REMOVE))
+		memset(block, 0, len);		// file system can't punch holes
+}
+
+static void payload_stamp(unsigned long long *buf, unsigned int lba, unsigned int version) {
+	unsigned long long seed = ((unsigned long long)lba << 32) | version;
+	unsigned int i;
+
+	buf[0] = seed;
+	for (i = 1; i < PAYLOAD_WORDS_PER_BLOCK; i++)
+		buf[i] = PAYLOAD_WORD(seed, i);
+}
+
+static void payload_mismatch(struct nvme_request_entry *req, unsigned int lba, unsigned long long head, const char *why) {
+	if (g_payload.mismatches++ < PAYLOAD_MISMATCH_PRINT_MAX)
+		printf("[PAYLOAD] %s: Host[%u] lba %u got lba %u ver %u (stamped %u, done %u)\n", why, req->hid, lba,
+				(unsigned int)(head >> 32), (unsigned int)head, g_payload.lba[lba].stamped, g_payload.lba[lba].done);
+}
+
+/*
+ * A read may return any version between the last write that completed
+ * before it was submitted and the newest one handed to the device. Until
+ * the first write completes the slice is unmapped and the FTL hands back
+ * whatever its data buffer held, so such reads are not checked.
+ */
+static void payload_verify(struct nvme_request_entry *req, unsigned long long *buf, unsigned int lba) {
+	struct payload_lba *entry = &g_payload.lba[lba];
+	unsigned long long seed = buf[0];
+	unsigned int version = (unsigned int)seed;
+	unsigned int i;
+
+	if (!entry->first_done_time || entry->first_done_time >= req->request_time) {
+		g_payload.skipped_blks++;
+		return;
+	}
+
+	g_payload.verified_blks++;
+	if ((unsigned int)(seed >> 32) != lba || !version) {
+		payload_mismatch(req, lba, seed, "wrong block");
+		return;
+	}
+	if (version > entry->stamped) {
+		payload_mismatch(req, lba, seed, "future version");
+		return;
+	}
+	if (entry->done_time < req->request_time && version < entry->done) {
+		payload_mismatch(req, lba, seed, "stale version");
+		return;
+	}
+	for (i = 1; i < PAYLOAD_WORDS_PER_BLOCK; i++) {
+		if (buf[i] != PAYLOAD_WORD(seed, i)) {
+			payload_mismatch(req, lba, seed, "corrupted data");
+			return;
+		}
+	}
+}
+
+/* versions follow command submission, the order the FTL applies overlapping writes in */
+void payload_submit(struct nvme_request_entry *req) {
+	unsigned int i;
+
+	if (req->op != IO_NVM_WRITE)
+		return;
+
+	req->version = ++g_payload.next_version;
+	for (i = 0; i < req->nblks; i++)
+		g_payload.lba[req->blkaddr + i].stamped = req->version;
+}
+
+/* called for every 4KB auto DMA: RX carries host data in, TX carries it out */
+void payload_host_dma(struct nvme_request_entry *req, unsigned int direction, unsigned int cmd4KBOffset, unsigned int devAddr) {
+	unsigned int lba = req->blkaddr + cmd4KBOffset;
+	unsigned long long *buf = Addr2Mem(unsigned long long, devAddr);
+
+	if (direction == HOST_DMA_RX_DIRECTION) {
+		payload_stamp(buf, lba, req->version);
+		g_payload.stamped_blks++;
+	} else
+		payload_verify(req, buf, lba);
+}
+
+void payload_write_done(struct nvme_request_entry *req) {
+	struct payload_lba *entry;
+	unsigned int i;
+
+	for (i = 0; i < req->nblks; i++) {
+		entry = &g_payload.lba[req->blkaddr + i];
+		if (entry->done < req->version)
+			entry->done = req->version;
+		entry->done_time = g_timer.current_time;
+		if (!entry->first_done_time)
+			entry->first_done_time = g_timer.current_time;
+	}
+}
+
+void show_payload_stats() {
+	if (!g_payload.enabled)
+		return;
+
+	printf("==== Payload ====\n");
+	printf("Stamped blocks  : %llu\n", g_payload.stamped_blks);
+	printf("Verified blocks : %llu\n", g_payload.verified_blks);
+	printf("Skipped blocks  : %llu (not yet written)\n", g_payload.skipped_blks);
+	printf("Mismatches      : %llu\n", g_payload.mismatches);
+}
@@ -0,0 +1,45 @@
+#ifndef SIM_PAYLOAD_H_
+#define SIM_PAYLOAD_H_
+
+#include "ftl_config.h"
+
+#define PAYLOAD_ROWS_PER_DIE		(TOTAL_BLOCKS_PER_DIE * PAGES_PER_MLC_BLOCK)
+#define PAYLOAD_ROW_STRIDE			((BYTES_PER_NAND_ROW + 4095) / 4096 * 4096)	// page aligned, the data region fills whole pages
+#define PAYLOAD_IMAGE_SIZE			((unsigned long long)USER_CHANNELS * USER_WAYS * PAYLOAD_ROWS_PER_DIE * PAYLOAD_ROW_STRIDE)
+#define PAYLOAD_MISMATCH_PRINT_MAX	10
+
+/* host-side state of one 4KB LBA */
+struct payload_lba {
+	unsigned int stamped;				// newest version submitted to the device
+	unsigned int done;					// newest version whose write completed
+	unsigned long long done_time;
+	unsigned long long first_done_time;	// 0 until the first write completes
+};
+
+struct payload {
+	int enabled;
+	int file;							// image is a shared file mapping
+	unsigned char *image;				// NAND rows, PAYLOAD_ROW_STRIDE apart
+	struct payload_lba *lba;
+	unsigned int next_version;
+	unsigned long long stamped_blks;
+	unsigned long long verified_blks;
+	unsigned long long skipped_blks;	// read before any write completed
+	unsigned long long mismatches;
+};
+
+extern struct payload g_payload;
+
+struct nvme_request_entry;
+
+void init_payload(const char *path);
+void payload_program(unsigned int ch, unsigned int way, unsigned int rowAddr, unsigned int dataAddr, unsigned int spareAddr);
+void payload_read(unsigned int ch, unsigned int way, unsigned int rowAddr, unsigned int dataAddr, unsigned int spareAddr);
+void payload_read_raw(unsigned int ch, unsigned int way, unsigned int rowAddr, unsigned int dataAddr);
+void payload_erase(unsigned int ch, unsigned int way, unsigned int rowAddr);
+void payload_submit(struct nvme_request_entry *req);
+void payload_host_dma(struct nvme_request_entry *req, unsigned int direction, unsigned int cmd4KBOffset, unsigned int devAddr);
+void payload_write_done(struct nvme_request_entry *req);
+void show_payload_stats();
+
+#endif /* SIM_PAYLOAD_H_ */
@@ -0,0 +1,54 @@
+#ifndef SIM_RAND_H_
+#define SIM_RAND_H_
+
+#include <stdint.h>
+
+/*
+ * xoshiro256** (Blackman and Vigna), one per worker so workers don't share
+ * a stream and a run only depends on --seed, not on the libc rand().
+ */
+struct rng {
+	uint64_t s[4];
+};
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+/* state from splitmix64 of the seed and the stream, never all zero */
+static inline void rng_seed(struct rng *r, uint64_t seed, uint64_t stream) {
+	uint64_t x = seed ^ (stream * 0x9E3779B97F4A7C15ULL), z;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		r->s[i] = z ^ (z >> 31);
+	}
+}
+
+static inline uint64_t rng_next(struct rng *r) {
+	uint64_t result = rng_rotl(r->s[1] * 5, 7) * 9;
+	uint64_t t = r->s[1] << 17;
+
+	r->s[2] ^= r->s[0];
+	r->s[3] ^= r->s[1];
+	r->s[1] ^= r->s[2];
+	r->s[0] ^= r->s[3];
+	r->s[2] ^= t;
+	r->s[3] = rng_rotl(r->s[3], 45);
+	return result;
+}
+
+/* in [0, n), multiply-shift instead of a division; the bias is below n / 2^64 */
+static inline uint64_t rng_below(struct rng *r, uint64_t n) {
+	return (uint64_t)(((unsigned __int128)rng_next(r) * n) >> 64);
+}
+
+/* in [0, 1), 53 random bits */
+static inline double rng_double(struct rng *r) {
+	return (rng_next(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif /* SIM_RAND_H_ */
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sim_main.h"
+#include "sim_backend.h"
+#include "sim_snapshot.h"
+#include "memory_map.h"
+
+extern unsigned int g_cb_tick;
+extern unsigned int g_last_update_tick[USER_DIES][USER_BLOCKS_PER_DIE];
+
+struct snapshot_object {
+	const char *name;
+	void *ptr;
+	unsigned long long size;
+	int mappable;		// lives in g_mem, page-aligned parts are mapped from the file
+};
+
+static struct snapshot_host snapshot_hosts[MAX_WORKERS];
+
+/*
+ * The FTL state a warm start needs. The data buffer, request pool and
+ * scheduler tables are left as InitFTL() built them: the snapshot is taken
+ * with no request in flight and save_snapshot() has written every dirty
+ * entry back, so a clean buffer is all they need to agree on.
+ */
+static int snapshot_objects(struct snapshot_object *obj, unsigned int nhosts) {
+	int n = 0;
+
+	obj[n++] = (struct snapshot_object){"logical slice map", logicalSliceMapPtr, sizeof(LOGICAL_SLICE_MAP), 1};
+	obj[n++] = (struct snapshot_object){"virtual slice map", virtualSliceMapPtr, sizeof(VIRTUAL_SLICE_MAP), 1};
+	obj[n++] = (struct snapshot_object){"virtual block map", virtualBlockMapPtr, sizeof(VIRTUAL_BLOCK_MAP), 1};
+	obj[n++] = (struct snapshot_object){"virtual die map", virtualDieMapPtr, sizeof(VIRTUAL_DIE_MAP), 1};
+	obj[n++] = (struct snapshot_object){"gc victim map", gcVictimMapPtr, sizeof(GC_VICTIM_MAP), 1};
+	obj[n++] = (struct snapshot_object){"row addr dependency", rowAddrDependencyTablePtr, sizeof(ROW_ADDR_DEPENDENCY_TABLE), 1};
+	obj[n++] = (struct snapshot_object){"last update tick", g_last_update_tick, sizeof(g_last_update_tick), 0};
+	obj[n++] = (struct snapshot_object){"cb tick", &g_cb_tick, sizeof(g_cb_tick), 0};
+	obj[n++] = (struct snapshot_object){"stream blocks", streamBlock, sizeof(streamBlock), 0};
+	obj[n++] = (struct snapshot_object){"slice write counts", sliceWriteCnt, sizeof(sliceWriteCnt), 0};
+	obj[n++] = (struct snapshot_object){"allocation target die", &sliceAllocationTargetDie, sizeof(sliceAllocationTargetDie), 0};
+	obj[n++] = (struct snapshot_object){"gc rng", &gcRng, sizeof(gcRng), 0};
+	obj[n++] = (struct snapshot_object){"host cursors", snapshot_hosts, sizeof(struct snapshot_host) * nhosts, 0};
+
+	return n;
+}
+
+static void snapshot_geometry(struct snapshot_header *header) {
+	header->channels = USER_CHANNELS;
+	header->ways = USER_WAYS;
+	header->blocks_per_die = USER_BLOCKS_PER_DIE;
+	header->pages_per_block = USER_PAGES_PER_BLOCK;
+	header->capacity_lba = MAX_LBA;
+}
+
+static void snapshot_write(int fd, const void *buf, unsigned long long size, unsigned long long offset, const char *path) {
+	const char *p = (const char *)buf;
+	ssize_t ret;
+
+	while (size) {
+		ret = pwrite(fd, p, size, offset);
+		if (ret <= 0) {
+			fprintf(stderr, "Failed to write snapshot %s.\n", path);
+			exit(1);
+		}
+		p += ret;
+		size -= ret;
+		offset += ret;
+	}
+}
+
+/* called at exit, the FTL is drained first so no table is mid-update and no write sits only in a data buffer */
+void save_snapshot(const char *path) {
+	struct snapshot_object obj[SNAPSHOT_SECTION_MAX];
+	struct snapshot_header header;
+	unsigned long long page = sysconf(_SC_PAGESIZE);
+	unsigned long long offset = SNAPSHOT_HEADER_SIZE;
+	int fd, i, n;
+
+	FlushDataBuf();
+	FinishGarbageCollection();
+	SyncAllLowLevelReqDone();
+
+	for (i = 0; i < sim.config.nhosts; i++) {
+		snapshot_hosts[i].next_blkaddr = sim.hosts[i].next_blkaddr;
+		snapshot_hosts[i].acc = sim.hosts[i].acc;
+		snapshot_hosts[i].rng = sim.hosts[i].rng;
+	}
+	n = snapshot_objects(obj, sim.config.nhosts);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to create snapshot %s.\n", path);
+		exit(1);
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.nsections = n;
+	header.nhosts = sim.config.nhosts;
+	header.hotcold = sim.config.hotcold;
+	header.gc_victim = sim.config.gc_victim;
+	snapshot_geometry(&header);
+
+	for (i = 0; i < n; i++) {
+		offset = (offset + page - 1) / page * page + (uintptr_t)obj[i].ptr % page;
+		strncpy(header.section[i].name, obj[i].name, sizeof(header.section[i].name) - 1);
+		header.section[i].offset = offset;
+		header.section[i].size = obj[i].size;
+		snapshot_write(fd, obj[i].ptr, obj[i].size, offset, path);
+		offset += obj[i].size;
+	}
+	snapshot_write(fd, &header, sizeof(header), 0, path);
+	close(fd);
+
+	printf("Snapshot saved to %s (%llu MB)\n", path, offset >> 20);
+}
+
+static void snapshot_restore_object(struct snapshot_object *obj, const char *file, int fd, unsigned long long offset) {
+	unsigned long long page = sysconf(_SC_PAGESIZE);
+	char *start = (char *)obj->ptr;
+	char *end = start + obj->size;
+	char *inner_start = (char *)(((uintptr_t)start + page - 1) & ~(uintptr_t)(page - 1));
+	char *inner_end = (char *)((uintptr_t)end & ~(uintptr_t)(page - 1));
+
+	if (!obj->mappable || inner_start >= inner_end) {
+		memcpy(start, file + offset, obj->size);
+		return;
+	}
+
+	/* whole pages come straight from the file and are only read in when touched */
+	if (mmap(inner_start, inner_end - inner_start, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, offset + (inner_start - start)) == MAP_FAILED) {
+		fprintf(stderr, "Failed to map snapshot section %s.\n", obj->name);
+		exit(1);
+	}
+	memcpy(start, file + offset, inner_start - start);
+	memcpy(inner_end, file + offset + (inner_end - start), end - inner_end);
+}
+
+void restore_snapshot(const char *path) {
+	struct snapshot_object obj[SNAPSHOT_SECTION_MAX];
+	struct snapshot_header header, expect;
+	struct stat st;
+	char *file;
+	int fd, i, n;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) || st.st_size < SNAPSHOT_HEADER_SIZE) {
+		fprintf(stderr, "Failed to open snapshot %s.\n", path);
+		exit(1);
+	}
+	file = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (file == MAP_FAILED) {
+		fprintf(stderr, "Failed to map snapshot %s.\n", path);
+		exit(1);
+	}
+	memcpy(&header, file, sizeof(header));
+
+	memset(&expect, 0, sizeof(expect));
+	snapshot_geometry(&expect);
+	if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic))) {
+		fprintf(stderr, "%s is not a snapshot.\n", path);
+		exit(1);
+	}
+	if (header.version != SNAPSHOT_VERSION) {
+		fprintf(stderr, "%s: snapshot version %u, expected %u.\n", path, header.version, SNAPSHOT_VERSION);
+		exit(1);
+	}
+	if (header.channels != expect.channels || header.ways != expect.ways || header.blocks_per_die != expect.blocks_per_die ||
+			header.pages_per_block != expect.pages_per_block || header.capacity_lba != expect.capacity_lba) {
+		fprintf(stderr, "%s: snapshot was taken with a different geometry.\n", path);
+		exit(1);
+	}
+	/* the open hot/cold/GC stream blocks are only ever filled again with the same mode */
+	if (header.hotcold != sim.config.hotcold) {
+		fprintf(stderr, "%s: snapshot was taken %s write streams (-H).\n", path, header.hotcold ? "with" : "without");
+		exit(1);
+	}
+	if (header.gc_victim != sim.config.gc_victim && header.gc_victim < GC_VICTIM_POLICIES)
+		printf("Snapshot was aged with GC victim policy %s\n", gcVictimPolicyNames[header.gc_victim]);
+
+	if (header.nhosts > sizeof(snapshot_hosts) / sizeof(snapshot_hosts[0])) {
+		fprintf(stderr, "%s: too many workers %u.\n", path, header.nhosts);
+		exit(1);
+	}
+	n = snapshot_objects(obj, header.nhosts);
+	if (header.nsections != n) {
+		fprintf(stderr, "%s: %u sections, expected %d.\n", path, header.nsections, n);
+		exit(1);
+	}
+	for (i = 0; i < n; i++) {
+		if (strcmp(header.section[i].name, obj[i].name) || header.section[i].size != obj[i].size ||
+				header.section[i].offset + header.section[i].size > st.st_size) {
+			fprintf(stderr, "%s: section %s doesn't match this build.\n", path, obj[i].name);
+			exit(1);
+		}
+		snapshot_restore_object(&obj[i], file, fd, header.section[i].offset);
+	}
+
+	munmap(file, st.st_size);
+	close(fd);
+
+	if (header.nhosts != sim.config.nhosts) {
+		printf("Snapshot has %u workers, host cursors not restored\n", header.nhosts);
+		return;
+	}
+	for (i = 0; i < sim.config.nhosts; i++) {
+		sim.hosts[i].next_blkaddr = snapshot_hosts[i].next_blkaddr;
+		sim.hosts[i].acc = snapshot_hosts[i].acc;
+		sim.hosts[i].rng = snapshot_hosts[i].rng;
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef SIM_SNAPSHOT_H_
+#define SIM_SNAPSHOT_H_
+
+#include "sim_rand.h"
+
+#define SNAPSHOT_MAGIC				"COSMSNAP"
+#define SNAPSHOT_VERSION			5
+#define SNAPSHOT_HEADER_SIZE		4096
+#define SNAPSHOT_SECTION_MAX		16
+
+/* one saved object, stored at a file offset congruent to its address mod the page size */
+struct snapshot_section {
+	char name[32];
+	unsigned long long offset;
+	unsigned long long size;
+};
+
+struct snapshot_header {
+	char magic[8];
+	unsigned int version;
+	unsigned int nsections;
+	/* geometry the tables were built for */
+	unsigned int channels;
+	unsigned int ways;
+	unsigned int blocks_per_die;
+	unsigned int pages_per_block;
+	unsigned int capacity_lba;
+	unsigned int nhosts;
+	/* FTL modes the tables were written with */
+	int hotcold;
+	unsigned int gc_victim;
+	struct snapshot_section section[SNAPSHOT_SECTION_MAX];
+};
+
+/* host cursors, so a restored run continues the access stream */
+struct snapshot_host {
+	unsigned int next_blkaddr;
+	unsigned int acc;
+	struct rng rng;
+};
+
+void save_snapshot(const char *path);
+void restore_snapshot(const char *path);
+
+#endif /* SIM_SNAPSHOT_H_ */
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "request_allocation.h"
+#include "request_transform.h"
+
+#include "sim_main.h"
+#include "sim_frontend.h"
+#include "sim_backend.h"
+#include "sim_lat.h"
+#include "sim_stall.h"
+
+extern struct fe_status fe_stat;
+
+struct stall_stats {
+	TAILQ_HEAD(, nvme_request_entry) inflight;	// commands sent and not completed yet
+	unsigned int cur_gc;		// run being issued, its NAND requests are tagged at allocation
+	unsigned short gc_of[AVAILABLE_OUNTSTANDING_REQ_COUNT];
+	unsigned char open[AVAILABLE_OUNTSTANDING_REQ_COUNT];	// bit per kind the FTL request is held by
+	unsigned char gc_head[USER_CHANNELS][USER_WAYS];	// a GC request heads the die's NAND queue
+	struct stall_gc_run gc[STALL_GC_RUNS_MAX];
+	unsigned int gc_free;
+	unsigned long long gc_runs;
+	unsigned long long gc_runs_untracked;
+	unsigned long long gc_runs_done;
+	unsigned long long gc_time;
+	unsigned long long gc_enter;
+	unsigned long long gc_sync_time;	// simulated time spent inside GarbageCollection()
+	unsigned long long flush_writes;	// FlushDataBuf() write-backs, charged to no command
+	unsigned long long stalled[2][STALL_KINDS];		// commands with some time of the kind, w 0 r 1
+	unsigned long long lat_sum[2][LAT_BUCKETS];		// by latency bucket, for the tail share
+	unsigned long long stall_sum[2][STALL_KINDS][LAT_BUCKETS];
+};
+
+static struct stall_stats g_stall;
+
+static const char *stall_names[STALL_KINDS] = {"gc", "erase", "bufdep", "rowdep"};
+
+void init_stall() {
+	unsigned int i;
+
+	memset(&g_stall, 0, sizeof(g_stall));
+	TAILQ_INIT(&g_stall.inflight);
+	g_stall.cur_gc = STALL_GC_NONE;
+	for (i = 0; i < AVAILABLE_OUNTSTANDING_REQ_COUNT; i++)
+		g_stall.gc_of[i] = STALL_GC_NONE;
+	for (i = 0; i < STALL_GC_RUNS_MAX; i++)
+		g_stall.gc[i].next_free = i + 1 < STALL_GC_RUNS_MAX ? i + 1 : STALL_GC_NONE;
+	g_stall.gc_free = 0;
+}
+
+static void stall_begin(struct nvme_request_entry *req, unsigned int kind) {
+	if (!req->stall_open[kind]++)
+		req->stall_since[kind] = g_timer.current_time;
+}
+
+static void stall_end(struct nvme_request_entry *req, unsigned int kind) {
+	if (req->stall_open[kind] && !--req->stall_open[kind])
+		req->stall[kind] += g_timer.current_time - req->stall_since[kind];
+}
+
+/* host command an FTL request works for: its data buffer entry or host DMA, NULL for GC copies and erases */
+static struct nvme_request_entry *stall_owner(unsigned int reqSlotTag) {
+	SSD_REQ_FORMAT *ftl_req = &reqPoolPtr->reqPool[reqSlotTag];
+
+	if (ftl_req->reqType != REQ_TYPE_NVME_DMA && ftl_req->reqOpt.dataBufFormat != REQ_OPT_DATA_BUF_ENTRY)
+		return NULL;
+	if (ftl_req->nvmeCmdSlotTag == NVME_CMD_SLOT_TAG_FLUSH)
+		return NULL;
+	return fe_stat.slot[ftl_req->nvmeCmdSlotTag % FE_SLOTS];
+}
+
+/*
+ * The FTL issues nothing else while it is inside GarbageCollection() and
+ * time only moves there when it waits for free requests, so every command
+ * outstanding at that point waits for the GC. Only g_stall.inflight is
+ * walked, not every cmd_id slot.
+ */
+static void stall_freeze(int on) {
+	struct nvme_request_entry *req;
+
+	TAILQ_FOREACH(req, &g_stall.inflight, stall_entry) {
+		if (on) {
+			req->stall_frozen = 1;
+			stall_begin(req, STALL_GC);
+		} else if (req->stall_frozen) {
+			req->stall_frozen = 0;
+			stall_end(req, STALL_GC);
+		}
+	}
+}
+
+void stall_submit(struct nvme_request_entry *req) {
+	TAILQ_INSERT_TAIL(&g_stall.inflight, req, stall_entry);
+}
+
+void stall_gc_begin() {
+	struct stall_gc_run *run;
+	unsigned int idx = g_stall.gc_free;
+
+	g_stall.gc_runs++;
+	g_stall.gc_enter = g_timer.current_time;
+	stall_freeze(1);
+	if (idx == STALL_GC_NONE) {
+		g_stall.gc_runs_untracked++;
+		return;
+	}
+	run = &g_stall.gc[idx];
+	g_stall.gc_free = run->next_free;
+	g_stall.cur_gc = idx;
+	run->start = g_timer.current_time;
+	run->pending = 0;
+	run->issuing = 1;
+}
+
+static void stall_gc_finish(unsigned int idx) {
+	struct stall_gc_run *run = &g_stall.gc[idx];
+
+	g_stall.gc_runs_done++;
+	g_stall.gc_time += g_timer.current_time - run->start;
+	run->next_free = g_stall.gc_free;
+	g_stall.gc_free = idx;
+}
+
+void stall_gc_end() {
+	unsigned int idx = g_stall.cur_gc;
+
+	g_stall.gc_sync_time += g_timer.current_time - g_stall.gc_enter;
+	stall_freeze(0);
+	if (idx == STALL_GC_NONE)
+		return;
+	g_stall.cur_gc = STALL_GC_NONE;
+	g_stall.gc[idx].issuing = 0;
+	if (!g_stall.gc[idx].pending)
+		stall_gc_finish(idx);
+}
+
+void stall_req_alloc(unsigned int reqSlotTag) {
+	g_stall.gc_of[reqSlotTag] = g_stall.cur_gc;
+	if (g_stall.cur_gc != STALL_GC_NONE)
+		g_stall.gc[g_stall.cur_gc].pending++;
+}
+
+static void stall_req_done(unsigned int reqSlotTag) {
+	unsigned int idx = g_stall.gc_of[reqSlotTag];
+
+	if (idx == STALL_GC_NONE)
+		return;
+	g_stall.gc_of[reqSlotTag] = STALL_GC_NONE;
+	if (!--g_stall.gc[idx].pending && !g_stall.gc[idx].issuing)
+		stall_gc_finish(idx);
+}
+
+void stall_block(unsigned int reqSlotTag, unsigned int kind) {
+	struct nvme_request_entry *req = stall_owner(reqSlotTag);
+	unsigned int prev;
+
+	if (!req)
+		return;
+	/* waiting for the slice's own NAND read or an earlier DMA of the same slice is service, not a stall */
+	if (kind == STALL_BUF_DEP) {
+		prev = reqPoolPtr->reqPool[reqSlotTag].prevBlockingReq;
+		if (prev != REQ_SLOT_TAG_NONE && reqPoolPtr->reqPool[prev].logicalSliceAddr == reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr)
+			return;
+	}
+	g_stall.open[reqSlotTag] |= 1 << kind;
+	stall_begin(req, kind);
+}
+
+void stall_unblock(unsigned int reqSlotTag, unsigned int kind) {
+	struct nvme_request_entry *req;
+
+	if (!(g_stall.open[reqSlotTag] & (1 << kind)))
+		return;
+	g_stall.open[reqSlotTag] &= ~(1 << kind);
+	req = stall_owner(reqSlotTag);
+	if (req)
+		stall_end(req, kind);
+}
+
+/*
+ * The head of a die's NAND queue is the request the die works on. While
+ * that is a GC request every host request queued behind it waits for GC;
+ * the queue is only walked when the head switches between GC and host work.
+ */
+static void stall_nand_head(unsigned int chNo, unsigned int wayNo) {
+	unsigned int head = nandReqQ[chNo][wayNo].headReq, tag, gc;
+
+	gc = head != REQ_SLOT_TAG_NONE && g_stall.gc_of[head] != STALL_GC_NONE;
+	if (gc == g_stall.gc_head[chNo][wayNo])
+		return;
+	g_stall.gc_head[chNo][wayNo] = gc;
+
+	for (tag = head; tag != REQ_SLOT_TAG_NONE; tag = reqPoolPtr->reqPool[tag].nextReq) {
+		if (gc)
+			stall_block(tag, STALL_GC);
+		else
+			stall_unblock(tag, STALL_GC);
+	}
+}
+
+void stall_nand_queued(unsigned int reqSlotTag, unsigned int chNo, unsigned int wayNo) {
+	if (reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag == NVME_CMD_SLOT_TAG_FLUSH)
+		g_stall.flush_writes++;
+	if (nandReqQ[chNo][wayNo].headReq == reqSlotTag)
+		stall_nand_head(chNo, wayNo);
+	else if (g_stall.gc_head[chNo][wayNo])
+		stall_block(reqSlotTag, STALL_GC);
+}
+
+/* called once the request left the queue */
+void stall_nand_done(unsigned int reqSlotTag, unsigned int chNo, unsigned int wayNo) {
+	stall_unblock(reqSlotTag, STALL_GC);
+	stall_req_done(reqSlotTag);
+	stall_nand_head(chNo, wayNo);
+}
+
+/* the command completed, nothing of it can be blocked any more */
+void stall_settle(struct nvme_request_entry *req) {
+	unsigned int kind;
+
+	TAILQ_REMOVE(&g_stall.inflight, req, stall_entry);
+	for (kind = 0; kind < STALL_KINDS; kind++) {
+		if (!req->stall_open[kind])
+			continue;
+		req->stall[kind] += g_timer.current_time - req->stall_since[kind];
+		req->stall_open[kind] = 0;
+	}
+}
+
+void stall_report(struct nvme_request_entry *req, unsigned long long lat) {
+	unsigned int op = req->op - 1, b = lat_bucket(lat), kind;
+
+	g_stall.lat_sum[op][b] += lat;
+	for (kind = 0; kind < STALL_KINDS; kind++) {
+		if (!req->stall[kind])
+			continue;
+		g_stall.stalled[op][kind]++;
+		g_stall.stall_sum[op][kind][b] += req->stall[kind];
+	}
+}
+
+static void show_stall_share(const char *label, unsigned int op, unsigned int from) {
+	unsigned long long lat = 0, stall;
+	unsigned int kind, b;
+
+	for (b = from; b < LAT_BUCKETS; b++)
+		lat += g_stall.lat_sum[op][b];
+	printf("%-16s:", label);
+	for (kind = 0; kind < STALL_KINDS; kind++) {
+		stall = 0;
+		for (b = from; b < LAT_BUCKETS; b++)
+			stall += g_stall.stall_sum[op][kind][b];
+		printf(" %s %.1f%%", stall_names[kind], lat ? 100.0 * stall / lat : 0.0);
+	}
+	printf("\n");
+}
+
+/* share of total latency per cause, overall and for the commands at or above p99 */
+void show_stall_stats() {
+	static const char *op_names[2] = {"W", "R"};
+	unsigned long long pcts[LAT_NPCTS];
+	struct lat_hist all;
+	char label[32];
+	unsigned int op, kind;
+	int hid;
+
+	printf("==== GC Stall Attribution ====\n");
+	printf("GC runs         : %llu (mean %.1f us until the last copy/erase completed)\n", g_stall.gc_runs,
+			g_stall.gc_runs_done ? (double)g_stall.gc_time / g_stall.gc_runs_done : 0.0);
+	printf("GC sync time    : %llu us (FTL waiting for free requests inside GC)\n", g_stall.gc_sync_time);
+	if (g_stall.gc_runs_untracked)
+		printf("Untracked runs  : %llu (more than %u at once)\n", g_stall.gc_runs_untracked, STALL_GC_RUNS_MAX);
+	if (g_stall.flush_writes)
+		printf("Flush writes    : %llu (buffer write-backs of no command)\n", g_stall.flush_writes);
+
+	for (op = 0; op < 2; op++) {
+		lat_hist_reset(&all);
+		for (hid = 0; hid < sim.config.nhosts; hid++)
+			lat_hist_merge(&all, &sim.hosts[hid].lat_total[op]);
+		if (!all.count)
+			continue;
+		lat_hist_percentiles(&all, pcts);
+
+		snprintf(label, sizeof(label), "%s stalled ops", op_names[op]);
+		printf("%-16s:", label);
+		for (kind = 0; kind < STALL_KINDS; kind++)
+			printf(" %s %llu", stall_names[kind], g_stall.stalled[op][kind]);
+		printf(" of %llu\n", all.count);
+		snprintf(label, sizeof(label), "%s latency share", op_names[op]);
+		show_stall_share(label, op, 0);
+		snprintf(label, sizeof(label), "%s >= p99 %llu", op_names[op], pcts[2]);
+		show_stall_share(label, op, lat_bucket(pcts[2]));
+	}
+}
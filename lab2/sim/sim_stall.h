@@ -0,0 +1,45 @@
+#ifndef SIM_STALL_H_
+#define SIM_STALL_H_
+
+#include "ftl_config.h"
+
+/*
+ * Why a host command waited, in us of simulated time. Each cause is the
+ * union of the intervals any FTL request of the command was held by it, so
+ * a column never exceeds the command's latency; causes can overlap, e.g. a
+ * write DMA waiting for its eviction that sits behind GC copies counts as
+ * both gc and bufdep.
+ */
+#define STALL_GC					0	// FTL inside GarbageCollection(), or queued on a die a GC copy/erase holds
+#define STALL_ERASE					1	// SyncReleaseEraseReq before a read of the block
+#define STALL_BUF_DEP				2	// buffer entry still held by another slice
+#define STALL_ROW_DEP				3	// page not programmed yet or block waiting for its erase
+#define STALL_KINDS					4
+
+#define STALL_GC_RUNS_MAX			(USER_DIES * 8)	// GC runs followed at once, more are only counted
+#define STALL_GC_NONE				0xffff
+
+struct nvme_request_entry;
+
+/* a GarbageCollection() call, done when it returned and all its NAND requests completed */
+struct stall_gc_run {
+	unsigned long long start;
+	unsigned int pending;
+	int issuing;						// still inside GarbageCollection()
+	unsigned int next_free;
+};
+
+void init_stall();
+void stall_gc_begin();
+void stall_gc_end();
+void stall_submit(struct nvme_request_entry *req);
+void stall_req_alloc(unsigned int reqSlotTag);
+void stall_nand_queued(unsigned int reqSlotTag, unsigned int chNo, unsigned int wayNo);
+void stall_nand_done(unsigned int reqSlotTag, unsigned int chNo, unsigned int wayNo);
+void stall_block(unsigned int reqSlotTag, unsigned int kind);
+void stall_unblock(unsigned int reqSlotTag, unsigned int kind);
+void stall_settle(struct nvme_request_entry *req);
+void stall_report(struct nvme_request_entry *req, unsigned long long lat);
+void show_stall_stats();
+
+#endif /* SIM_STALL_H_ */
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_timing.h"
+#include "ftl_config.h"
+#include "address_translation.h"
+
+struct nand_timing g_nand_timing;
+
+/*
+ * "default" keeps the latencies the simulator always used
+ * (read 30, transfer 300, program 650, erase 15000, raw transfer 5);
+ * 60.16 MB/s moves one BYTES_PER_NAND_ROW row in exactly 300 ticks.
+ */
+static const struct nand_timing nand_timing_presets[] = {
+	{"default", 1, {30}, {650}, 15000, 60.16, 5},
+	{"slc", 1, {25}, {200}, 1500, 400.0, 5},
+	{"mlc", 2, {50, 80}, {400, 1600}, 3000, 400.0, 5},
+	{"tlc", 3, {60, 75, 90}, {700, 1400, 2100}, 3500, 800.0, 5},
+	{"qlc", 4, {80, 100, 120, 140}, {1500, 3000, 4500, 6000}, 10000, 800.0, 5},
+};
+
+#define NAND_TIMING_PRESETS		(sizeof(nand_timing_presets) / sizeof(nand_timing_presets[0]))
+
+void init_nand_timing() {
+	g_nand_timing = nand_timing_presets[0];
+}
+
+int set_nand_timing_preset(const char *name) {
+	int i;
+
+	for (i = 0; i < NAND_TIMING_PRESETS; i++) {
+		if (!strcmp(nand_timing_presets[i].name, name)) {
+			g_nand_timing = nand_timing_presets[i];
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static int parse_latency_list(char *val, unsigned long long *lat) {
+	char *token;
+	int n = 0;
+
+	token = strtok(val, " \t,");
+	while (token) {
+		if (n == NAND_PAGE_TYPE_MAX)
+			return -1;
+		lat[n++] = strtoull(token, NULL, 10);
+		token = strtok(NULL, " \t,");
+	}
+
+	return n;
+}
+
+/*
+ * Profile file, one "key value" per line, '#' starts a comment:
+ *   preset   tlc            # start from a preset (optional, first)
+ *   types    3              # page types per cell
+ *   tR       60 75 90       # per page type, LSB first
+ *   tPROG    700 1400 2100
+ *   tBERS    3500
+ *   xfer     800            # MB/s
+ *   tRAW     5
+ *   bus      400            # MT/s, enables channel bus contention
+ * Keys not given keep the value of the preset (or "default").
+ */
+int load_nand_timing_file(const char *path) {
+	FILE *fp;
+	char line[256], key[32], *val, *p;
+	int n, lineno = 0, nr = 0, nprog = 0;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+
+	init_nand_timing();
+	strncpy(g_nand_timing.name, path, NAND_TIMING_NAME_LEN - 1);
+	g_nand_timing.name[NAND_TIMING_NAME_LEN - 1] = '\0';
+
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if ((p = strchr(line, '#')))
+			*p = '\0';
+		if (sscanf(line, "%31s%n", key, &n) != 1)
+			continue;
+		val = line + n;
+
+		if (!strcmp(key, "preset")) {
+			if (sscanf(val, "%31s", key) != 1 || set_nand_timing_preset(key)) {
+				fprintf(stderr, "%s:%d: unknown preset.\n", path, lineno);
+				exit(1);
+			}
+		} else if (!strcmp(key, "types")) {
+			g_nand_timing.page_types = atoi(val);
+		} else if (!strcmp(key, "tR")) {
+			nr = parse_latency_list(val, g_nand_timing.t_r);
+		} else if (!strcmp(key, "tPROG")) {
+			nprog = parse_latency_list(val, g_nand_timing.t_prog);
+		} else if (!strcmp(key, "tBERS")) {
+			g_nand_timing.t_bers = strtoull(val, NULL, 10);
+		} else if (!strcmp(key, "xfer")) {
+			g_nand_timing.xfer_mbps = atof(val);
+		} else if (!strcmp(key, "tRAW")) {
+			g_nand_timing.t_raw = strtoull(val, NULL, 10);
+		} else if (!strcmp(key, "bus")) {
+			g_nand_timing.bus_mts = strtoul(val, NULL, 10);
+		} else {
+			fprintf(stderr, "%s:%d: unknown key %s.\n", path, lineno, key);
+			exit(1);
+		}
+
+		if (nr < 0 || nprog < 0) {
+			fprintf(stderr, "%s:%d: more than %d page types.\n", path, lineno, NAND_PAGE_TYPE_MAX);
+			exit(1);
+		}
+	}
+	fclose(fp);
+
+	if (!g_nand_timing.page_types || g_nand_timing.page_types > NAND_PAGE_TYPE_MAX) {
+		fprintf(stderr, "%s: types must be 1 ~ %d.\n", path, NAND_PAGE_TYPE_MAX);
+		exit(1);
+	}
+	if ((nr && nr != g_nand_timing.page_types) || (nprog && nprog != g_nand_timing.page_types)) {
+		fprintf(stderr, "%s: tR/tPROG need %d values.\n", path, g_nand_timing.page_types);
+		exit(1);
+	}
+	if (g_nand_timing.xfer_mbps <= 0) {
+		fprintf(stderr, "%s: xfer must be positive.\n", path);
+		exit(1);
+	}
+	if (g_nand_timing.bus_mts > NAND_BUS_MTS_MAX) {
+		fprintf(stderr, "%s: bus must be 0 ~ %d MT/s.\n", path, NAND_BUS_MTS_MAX);
+		exit(1);
+	}
+
+	return 0;
+}
+
+/* CLI entry: a preset name, or otherwise a profile file */
+void set_nand_timing(const char *arg) {
+	if (!set_nand_timing_preset(arg))
+		return;
+
+	if (load_nand_timing_file(arg)) {
+		fprintf(stderr, "Unknown NAND timing %s (presets: default slc mlc tlc qlc, or a file).\n", arg);
+		exit(1);
+	}
+}
+
+void show_nand_timing() {
+	unsigned int i;
+
+	printf("NAND timing %s (%u page type%s)\n", g_nand_timing.name, g_nand_timing.page_types, g_nand_timing.page_types > 1 ? "s" : "");
+	printf("  - tR");
+	for (i = 0; i < g_nand_timing.page_types; i++)
+		printf(" %llu", g_nand_timing.t_r[i]);
+	printf(", tPROG");
+	for (i = 0; i < g_nand_timing.page_types; i++)
+		printf(" %llu", g_nand_timing.t_prog[i]);
+	printf(", tBERS %llu", g_nand_timing.t_bers);
+	if (g_nand_timing.bus_mts)
+		printf(", bus %u MT/s shared per channel", g_nand_timing.bus_mts);
+	else
+		printf(", xfer %.2f MB/s", g_nand_timing.xfer_mbps);
+	printf(" (%llu per row)\n", nand_t_xfer(BYTES_PER_NAND_ROW));
+}
+
+/*
+ * The FTL runs in SLC mode and only uses the LSB rows from
+ * Vpage2PlsbPageTranslation(), so a paired-page map would never see an
+ * MSB row. For every preset the page types rotate with the virtual page
+ * index instead (LSB, MSB, LSB, ... for MLC), and each type's latency
+ * applies to 1/types of the pages.
+ */
+unsigned int nand_page_type(unsigned int rowAddr) {
+	return PlsbPage2VpageTranslation(rowAddr % PAGES_PER_MLC_BLOCK) % g_nand_timing.page_types;
+}
+
+unsigned long long nand_t_r(unsigned int rowAddr) {
+	return g_nand_timing.t_r[nand_page_type(rowAddr)];
+}
+
+unsigned long long nand_t_prog(unsigned int rowAddr) {
+	return g_nand_timing.t_prog[nand_page_type(rowAddr)];
+}
+
+unsigned long long nand_t_xfer(unsigned int bytes) {
+	if (g_nand_timing.bus_mts)
+		return ((unsigned long long)bytes + g_nand_timing.bus_mts * NAND_BUS_BYTES_PER_TRANSFER - 1) / (g_nand_timing.bus_mts * NAND_BUS_BYTES_PER_TRANSFER);
+
+	return (unsigned long long)(bytes / g_nand_timing.xfer_mbps + 0.5);
+}
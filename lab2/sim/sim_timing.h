@@ -0,0 +1,33 @@
+#ifndef SIM_TIMING_H_
+#define SIM_TIMING_H_
+
+#define NAND_TIMING_NAME_LEN		32
+#define NAND_PAGE_TYPE_MAX			4	// LSB, CSB, MSB, TSB
+#define NAND_BUS_BYTES_PER_TRANSFER	1	// 8-bit NV-DDR bus
+#define NAND_BUS_MTS_MAX			4800	// fastest Toggle/ONFI interface
+
+/* All latencies are in simulator ticks (us) */
+struct nand_timing {
+	char name[NAND_TIMING_NAME_LEN];
+	unsigned int page_types;		// 1 SLC, 2 MLC, 3 TLC, 4 QLC
+	unsigned long long t_r[NAND_PAGE_TYPE_MAX];
+	unsigned long long t_prog[NAND_PAGE_TYPE_MAX];
+	unsigned long long t_bers;
+	double xfer_mbps;				// channel transfer rate (bytes/us)
+	unsigned long long t_raw;		// raw page transfer (bad block table scan)
+	unsigned int bus_mts;			// 0: transfers don't hold the channel bus
+};
+
+extern struct nand_timing g_nand_timing;
+
+void init_nand_timing();
+int set_nand_timing_preset(const char *name);
+int load_nand_timing_file(const char *path);
+void set_nand_timing(const char *arg);
+void show_nand_timing();
+unsigned int nand_page_type(unsigned int rowAddr);
+unsigned long long nand_t_r(unsigned int rowAddr);
+unsigned long long nand_t_prog(unsigned int rowAddr);
+unsigned long long nand_t_xfer(unsigned int bytes);
+
+#endif /* SIM_TIMING_H_ */
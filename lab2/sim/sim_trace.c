@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "nvme.h"
+#include "sim_trace.h"
+
+#define TRACE_LINE_MAX				512
+
+const char *trace_format_names[] = {"blkparse", "msr", "bin"};
+
+/* next line without the newline, NUL-terminated in buf; 0 at the end of the file */
+static int trace_getline(struct trace *t, char *buf) {
+	const char *end = t->map + t->size;
+	const char *nl;
+	size_t len;
+
+	if (t->cur >= end)
+		return 0;
+	nl = memchr(t->cur, '\n', end - t->cur);
+	if (!nl)
+		nl = end;
+	len = nl - t->cur;
+	if (len > TRACE_LINE_MAX - 1)
+		len = TRACE_LINE_MAX - 1;
+	memcpy(buf, t->cur, len);
+	if (len && buf[len - 1] == '\r')
+		len--;
+	buf[len] = '\0';
+	t->cur = nl + 1;
+	return 1;
+}
+
+/* "  8,0    3        1     0.000000000   697  Q   W 223490 + 8 [kjournald]" */
+static int trace_parse_blkparse(struct trace *t, const char *line, struct trace_record *rec) {
+	char action[4], rwbs[16];
+	unsigned long long sector;
+	unsigned int nsectors;
+	double time;
+
+	if (sscanf(line, "%*s %*s %*s %lf %*s %3s %15s %llu + %u", &time, action, rwbs, &sector, &nsectors) != 5)
+		return 0;
+	if (action[1] || !strchr("QDC", action[0]))
+		return 0;
+	if (!t->action)
+		t->action = action[0];
+	if (action[0] != t->action || !nsectors || strchr(rwbs, 'D'))
+		return 0;
+
+	if (strchr(rwbs, 'W'))
+		rec->op = IO_NVM_WRITE;
+	else if (strchr(rwbs, 'R'))
+		rec->op = IO_NVM_READ;
+	else
+		return 0;
+	rec->time = (unsigned long long)(time * 1000000 + 0.5);
+	rec->sector = sector;
+	rec->nsectors = nsectors;
+	return 1;
+}
+
+/* "128166372003061629,hm,1,Read,7014609920,24576,41286", time in 100ns ticks, offset and size in bytes */
+static int trace_parse_msr(const char *line, struct trace_record *rec) {
+	unsigned long long time, offset;
+	unsigned int size;
+	char type[16];
+
+	if (sscanf(line, "%llu,%*[^,],%*[^,],%15[^,],%llu,%u", &time, type, &offset, &size) != 4 || !size)
+		return 0;
+	if (type[0] == 'W' || type[0] == 'w')
+		rec->op = IO_NVM_WRITE;
+	else if (type[0] == 'R' || type[0] == 'r')
+		rec->op = IO_NVM_READ;
+	else
+		return 0;
+	rec->time = time / 10;
+	rec->sector = offset / TRACE_SECTOR_SIZE;
+	rec->nsectors = (offset + size + TRACE_SECTOR_SIZE - 1) / TRACE_SECTOR_SIZE - rec->sector;
+	return 1;
+}
+
+/* the first line that is a request decides between the text formats */
+static int trace_detect(struct trace *t) {
+	struct trace_record rec;
+	char line[TRACE_LINE_MAX];
+	int format = TRACE_FORMAT_BLKPARSE;
+
+	while (trace_getline(t, line)) {
+		if (trace_parse_msr(line, &rec)) {
+			format = TRACE_FORMAT_MSR;
+			break;
+		}
+		if (trace_parse_blkparse(t, line, &rec))
+			break;
+	}
+	t->cur = t->map;
+	t->action = 0;
+	return format;
+}
+
+void trace_open(struct trace *t, const char *path) {
+	const struct trace_file_header *header;
+	struct stat st;
+	int fd;
+
+	memset(t, 0, sizeof(*t));
+	t->path = path;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		fprintf(stderr, "Failed to open trace %s.\n", path);
+		exit(1);
+	}
+	t->size = st.st_size;
+	if (!t->size) {
+		fprintf(stderr, "Trace %s is empty.\n", path);
+		exit(1);
+	}
+	t->map = mmap(NULL, t->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (t->map == MAP_FAILED) {
+		fprintf(stderr, "Failed to map trace %s.\n", path);
+		exit(1);
+	}
+	madvise((void *)t->map, t->size, MADV_SEQUENTIAL);
+	t->cur = t->map;
+
+	header = (const struct trace_file_header *)t->map;
+	if (t->size >= sizeof(*header) && !memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic))) {
+		if (header->version != TRACE_VERSION || header->record_size != sizeof(struct trace_record) ||
+				header->records > (t->size - sizeof(*header)) / sizeof(struct trace_record)) {
+			fprintf(stderr, "%s: unsupported or truncated binary trace.\n", path);
+			exit(1);
+		}
+		t->format = TRACE_FORMAT_BIN;
+		t->bin_records = header->records;
+		t->cur = t->map + sizeof(*header);
+		return;
+	}
+	t->format = trace_detect(t);
+}
+
+/* 1 for a request, 0 at the end of the trace */
+int trace_next(struct trace *t, struct trace_record *rec) {
+	char line[TRACE_LINE_MAX];
+
+	if (t->format == TRACE_FORMAT_BIN) {
+		if (t->records == t->bin_records)
+			return 0;
+		memcpy(rec, t->cur, sizeof(*rec));
+		t->cur += sizeof(*rec);
+		t->records++;
+		return 1;
+	}
+
+	while (trace_getline(t, line)) {
+		if (t->format == TRACE_FORMAT_MSR ? trace_parse_msr(line, rec) : trace_parse_blkparse(t, line, rec)) {
+			t->records++;
+			return 1;
+		}
+		if (line[0])
+			t->skipped++;
+	}
+	return 0;
+}
+
+void trace_close(struct trace *t) {
+	if (t->map && t->map != MAP_FAILED)
+		munmap((void *)t->map, t->size);
+	t->map = NULL;
+}
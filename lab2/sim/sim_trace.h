@@ -0,0 +1,50 @@
+#ifndef SIM_TRACE_H_
+#define SIM_TRACE_H_
+
+#include <stddef.h>
+
+#define TRACE_FORMAT_BLKPARSE		0	// blkparse default text output
+#define TRACE_FORMAT_MSR			1	// SNIA/MSR-Cambridge CSV: Timestamp,Hostname,DiskNumber,Type,Offset,Size,ResponseTime
+#define TRACE_FORMAT_BIN			2	// this header and trace_record[]
+
+#define TRACE_MAGIC					"COSMTRCE"
+#define TRACE_VERSION				1
+#define TRACE_SECTOR_SIZE			512
+
+struct trace_file_header {
+	char magic[8];
+	unsigned int version;
+	unsigned int record_size;
+	unsigned long long records;
+};
+
+struct trace_record {
+	unsigned long long time;		// us, from the trace's own clock
+	unsigned long long sector;		// 512B
+	unsigned int nsectors;
+	unsigned int op;				// IO_NVM_WRITE or IO_NVM_READ
+};
+
+/*
+ * A trace file mapped read-only and parsed as it is consumed, so a trace
+ * larger than memory costs only the pages around the cursor.
+ */
+struct trace {
+	const char *path;
+	int format;
+	const char *map;
+	size_t size;
+	const char *cur;
+	char action;					// blkparse: event the trace is read from, the first of Q/D/C seen
+	unsigned long long records;
+	unsigned long long bin_records;	// bin: records the header declares, trailing bytes are ignored
+	unsigned long long skipped;		// lines that aren't a read or write
+};
+
+extern const char *trace_format_names[];
+
+void trace_open(struct trace *t, const char *path);
+int trace_next(struct trace *t, struct trace_record *rec);
+void trace_close(struct trace *t);
+
+#endif /* SIM_TRACE_H_ */
@@ -0,0 +1,52 @@
+/*
+ * Converts the binary lat/perf history written with "-r -f bin" to the
+ * CSV the simulator writes with "-r" (same columns, same formatting).
+ *
+ *   make tools && ./tools/hist2csv out/lat.bin > out/lat.csv
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_hist.h"
+
+int main(int argc, char *argv[]) {
+	struct hist_file_header header;
+	unsigned long long rec[HIST_FIELDS_MAX];
+	unsigned long long last_time = 0, n = 0;
+	unsigned int f;
+	FILE *fp;
+	int ret;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <lat.bin|perf.bin>\n", argv[0]);
+		return 1;
+	}
+
+	fp = fopen(argv[1], "rb");
+	if (!fp) {
+		fprintf(stderr, "Failed to open %s.\n", argv[1]);
+		return 1;
+	}
+	if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, HIST_MAGIC, sizeof(header.magic))) {
+		fprintf(stderr, "%s is not a history file.\n", argv[1]);
+		return 1;
+	}
+	if (header.version != HIST_VERSION || header.fields < 1 || header.fields > HIST_FIELDS_MAX) {
+		fprintf(stderr, "%s: version %u with %u fields, expected %u with up to %u.\n", argv[1], header.version, header.fields, HIST_VERSION, HIST_FIELDS_MAX);
+		return 1;
+	}
+
+	while ((ret = hist_decode(fp, rec, header.fields, &last_time)) == 1) {
+		for (f = 0; f < header.fields; f++)
+			printf(f ? ",%llu" : "%llu", rec[f]);
+		printf("\n");
+		n++;
+	}
+	fclose(fp);
+
+	if (ret < 0) {
+		fprintf(stderr, "%s: truncated after %llu records.\n", argv[1], n);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * Converts a blkparse or MSR-Cambridge text trace to the binary trace
+ * "-T" replays without parsing, one fixed-size record per read or write.
+ * Times are kept as the trace has them (us); replay rebases them on the
+ * first record.
+ *
+ *   make tools && ./tools/trace2bin sda.blktrace.txt > sda.trc
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_trace.h"
+
+int main(int argc, char *argv[]) {
+	struct trace_file_header header;
+	struct trace_record rec;
+	struct trace t;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <trace> > <trace.trc>\n", argv[0]);
+		return 1;
+	}
+
+	trace_open(&t, argv[1]);
+	if (t.format == TRACE_FORMAT_BIN) {
+		fprintf(stderr, "%s is already a binary trace.\n", argv[1]);
+		return 1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(struct trace_record);
+	/* the record count is filled in at the end, stdout has to be seekable */
+	if (fwrite(&header, sizeof(header), 1, stdout) != 1) {
+		fprintf(stderr, "Failed to write the header.\n");
+		return 1;
+	}
+	while (trace_next(&t, &rec)) {
+		if (fwrite(&rec, sizeof(rec), 1, stdout) != 1) {
+			fprintf(stderr, "Failed to write record %llu.\n", t.records);
+			return 1;
+		}
+	}
+	header.records = t.records;
+	if (fseek(stdout, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, stdout) != 1) {
+		fprintf(stderr, "Output is not seekable, redirect it to a file.\n");
+		return 1;
+	}
+
+	fprintf(stderr, "%s: %s, %llu records, %llu lines skipped\n", argv[1], trace_format_names[t.format], t.records, t.skipped);
+	trace_close(&t);
+	return 0;
+}